@@ -0,0 +1,42 @@
+#ifndef ASSIGNMENT_HPP
+#define ASSIGNMENT_HPP
+
+#include "thread_pool.hpp"
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Rows x cols cost table in CSR layout. Only feasible pairs are stored; a
+// missing arc means the row can never take that column. Rows are appended
+// one at a time: add_arc() for each candidate, then end_row().
+struct SparseCostMatrix {
+    size_t num_cols = 0;
+    vector<size_t> offsets{0};
+    vector<int> cols;
+    vector<double> costs;
+
+    explicit SparseCostMatrix(size_t columns = 0);
+    void add_arc(int col, double cost);
+    void end_row();
+    size_t rows() const;
+};
+
+struct AssignmentResult {
+    static constexpr int UNASSIGNED = -1;
+
+    vector<int> col_of_row;
+    size_t assigned = 0;
+    double total_cost = 0.0;
+};
+
+// Min-cost one-to-one assignment by the forward auction algorithm with
+// epsilon scaling. Every row may also stay unassigned at unassigned_cost,
+// so the matrix can be rectangular and sparse. Bids of all unassigned rows
+// in a round are computed in parallel against the current prices and
+// resolved afterwards (Jacobi auction). The total is within
+// (rows + cols) * 1e-7 * max cost of the optimum.
+AssignmentResult auction_assign(const SparseCostMatrix& matrix, double unassigned_cost,
+                                ThreadPool& pool = ThreadPool::shared());
+
+#endif
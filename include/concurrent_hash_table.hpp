@@ -0,0 +1,103 @@
+#ifndef CONCURRENT_HASH_TABLE_HPP
+#define CONCURRENT_HASH_TABLE_HPP
+
+#include "epoch_reclaim.hpp"
+#include "types.hpp"
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <utility>
+
+using namespace std;
+
+// Thread-safe counterpart of HashTable for data shared between dispatch,
+// tracking and traffic threads. Keys are split over lock-striped shards;
+// each shard is a linear-probing array of atomic node pointers. Writers take
+// the shard lock, readers take no lock at all: find() is a bounded probe
+// over the published array and is wait-free. Replaced, removed and
+// outgrown nodes/arrays are retired through EpochDomain, so a reader inside
+// a find() or for_each() never touches freed memory, even mid-rehash.
+//
+// Overwriting a key publishes a new node, so an entry's address changes
+// when its key is replaced or removed. find() returns a Ref that keeps the
+// calling thread pinned: the entry it points at is not freed while the Ref
+// lives, even if another thread replaces or removes the key (the Ref then
+// still shows the old value). Fields mutated through a Ref are not
+// synchronized.
+template<typename K, typename V, typename Hash = hash<K>>
+class ConcurrentHashTable {
+private:
+    static constexpr size_t DEFAULT_SIZE = 101;
+    static constexpr size_t SHARD_BITS = 4;
+    static constexpr size_t SHARDS = size_t(1) << SHARD_BITS;
+
+    struct Node {
+        K key;
+        V value;
+    };
+
+    struct Table {
+        size_t mask;
+        unique_ptr<atomic<Node*>[]> slots;
+        explicit Table(size_t capacity);
+    };
+
+    struct alignas(64) Shard {
+        mutex mtx;
+        atomic<Table*> table{nullptr};
+        size_t used = 0;
+        size_t live = 0;
+    };
+
+    Shard shards[SHARDS];
+    atomic<size_t> num_elements{0};
+    Hash hash_func;
+    EpochDomain& epochs;
+
+    size_t hash_of(const K& key) const;
+    Shard& shard_of(size_t h);
+    const Shard& shard_of(size_t h) const;
+    void upsert_locked(Shard& shard, const K& key, size_t h, V value);
+    void grow_locked(Shard& shard, size_t min_live);
+    Node* locate(const K& key) const;
+
+public:
+    template<typename T>
+    class Ref {
+    private:
+        EpochDomain::Guard guard;
+        T* ptr;
+
+    public:
+        Ref(EpochDomain& domain, T* p) : guard(domain), ptr(p) {}
+        explicit operator bool() const { return ptr != nullptr; }
+        T& operator*() const { return *ptr; }
+        T* operator->() const { return ptr; }
+        T* get() const { return ptr; }
+    };
+
+    explicit ConcurrentHashTable(size_t initial_size = DEFAULT_SIZE, Hash hasher = Hash(),
+                                 EpochDomain& domain = EpochDomain::global());
+    ~ConcurrentHashTable();
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    void insert(const K& key, V value);
+    void insert_many(vector<pair<K, V>> items);
+    Ref<V> find(const K& key);
+    Ref<const V> find(const K& key) const;
+    bool remove(const K& key);
+    size_t size() const;
+    bool empty() const;
+
+    void for_each(const function<void(const K&, V&)>& fn);
+    void for_each(const function<void(const K&, const V&)>& fn) const;
+    vector<pair<K, V>> snapshot() const;
+
+    EpochDomain::Guard pin() const;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CONTRACTION_HIERARCHY_HPP
+#define CONTRACTION_HIERARCHY_HPP
+
+#include "csr_graph.hpp"
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+class RoadNetwork;
+
+// Customizable contraction hierarchy over the frozen CSR graph.
+//
+// Preprocessing is split in two: build_order() computes a nested-dissection
+// contraction order and the resulting chordal upward arc structure from the
+// graph topology alone, and customize() assigns the current Edge::weight
+// values to those arcs with one pass of lower-triangle relaxations. Traffic
+// updates only require customize(); the order is rebuilt only when edges
+// are added or removed. Queries walk the elimination tree from both ends.
+class ContractionHierarchy {
+private:
+    const RoadNetwork& graph;
+
+    vector<int> rank;
+    vector<int> order;
+    vector<int> etree_parent;
+
+    vector<size_t> up_offsets;
+    vector<int> up_tails;
+    vector<int> up_heads;
+    vector<double> arc_up;
+    vector<double> arc_down;
+    vector<int> up_mid;
+    vector<int> down_mid;
+
+    vector<long> edge_arc;
+    vector<char> edge_down;
+
+    vector<double> fdist, bdist;
+    vector<int> fpar, bpar;
+
+    unsigned long seen_generation = 0;
+    unsigned long seen_epoch = 0;
+    bool built = false;
+
+    void prepare();
+    void compute_order(const CsrGraph& g);
+    void compute_arcs(const CsrGraph& g);
+    long find_arc(int lo, int hi) const;
+    void unpack(long arc, bool down, vector<int>& out) const;
+    void sweep(int start, const vector<double>& w, vector<double>& dist, vector<int>& par);
+    void clear_chain(int start, vector<double>& dist, vector<int>& par);
+    int search(int s, int t, double& best);
+    void reset(int s, int t);
+
+public:
+    explicit ContractionHierarchy(const RoadNetwork& g);
+
+    void build_order();
+    void customize();
+
+    vector<int> shortest_path(int start, int goal);
+    double distance(int start, int goal);
+    vector<double> many_to_many(const vector<int>& sources, const vector<int>& targets);
+    size_t num_arcs() const;
+    int rank_of(int idx) const;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CSR_GRAPH_HPP
+#define CSR_GRAPH_HPP
+
+#include "types.hpp"
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Frozen compressed-sparse-row view of a RoadNetwork. External node IDs are
+// remapped to dense indices 0..N-1 (in ascending ID order); the out-edges of
+// node u occupy [offsets[u], offsets[u+1]) in targets/weights/base_weights.
+// The in-edges of v occupy [rev_offsets[v], rev_offsets[v+1]) and refer back
+// to the forward slot, so in-place weight updates are seen by both directions.
+struct CsrGraph {
+    vector<int> node_ids;
+    unordered_map<int, int> node_index;
+    vector<size_t> offsets;
+    vector<int> targets;
+    vector<double> weights;
+    vector<double> base_weights;
+    vector<size_t> rev_offsets;
+    vector<int> rev_sources;
+    vector<size_t> rev_slots;
+    vector<double> xs, ys;
+    unsigned long generation = 0;
+
+    void build(const unordered_map<int, vector<Edge>>& adj,
+               const unordered_map<int, pair<double, double>>& positions = {});
+    void clear();
+
+    size_t num_nodes() const;
+    size_t num_edges() const;
+    int index_of(int id) const;
+    int id_of(int idx) const;
+    long find_edge(int u, int v) const;
+    bool has_position(int idx) const;
+};
+
+#endif
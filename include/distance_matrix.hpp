@@ -0,0 +1,33 @@
+#ifndef DISTANCE_MATRIX_HPP
+#define DISTANCE_MATRIX_HPP
+
+#include "road_network.hpp"
+#include "priority_queue.hpp"
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+// Dense sources x targets road-cost table. Entries are infinity when the
+// target is unreachable; paths are only filled in when requested.
+struct DistanceMatrix {
+    vector<int> sources;
+    vector<int> targets;
+    vector<double> costs;
+    vector<vector<int>> paths;
+    unordered_map<int, size_t> row_of;
+    unordered_map<int, size_t> col_of;
+
+    double cost(size_t row, size_t col) const;
+    double between(int from, int to) const;
+    const vector<int>& path(size_t row, size_t col) const;
+    bool has_paths() const;
+};
+
+// Outside CH mode each row is a one-to-many Dijkstra whose frontier is
+// chosen at compile time; the radix heap is the default for bulk tables.
+template<typename Frontier = RadixFrontier>
+DistanceMatrix many_to_many(const RoadNetwork& graph, const vector<int>& sources,
+                            const vector<int>& targets, bool with_paths = false);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef DYNAMIC_SSSP_HPP
+#define DYNAMIC_SSSP_HPP
+
+#include "csr_graph.hpp"
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+class RoadNetwork;
+struct EdgeChange;
+
+// Shortest-path trees rooted at hub nodes (depots, warehouses) that are
+// repaired incrementally from the RoadNetwork change log instead of being
+// recomputed. A weight increase on a tree edge invalidates only the subtree
+// below it, which is re-seeded from its unaffected in-neighbours; weight
+// decreases seed their head node. Both are then settled by one Dijkstra pass
+// over the affected region. Edge insertions/removals rebuild the trees.
+class DynamicSSSP {
+private:
+    struct Tree {
+        int root;
+        vector<double> dist;
+        vector<int> parent;
+        vector<long> parent_slot;
+    };
+
+    const RoadNetwork& graph;
+    vector<int> hub_ids;
+    unordered_map<int, size_t> hub_index;
+    vector<Tree> trees;
+    vector<char> affected;
+
+    unsigned long seen_generation = 0;
+    unsigned long seen_epoch = 0;
+    bool built = false;
+    size_t repaired = 0;
+
+    void rebuild(const CsrGraph& g);
+    void grow(const CsrGraph& g, Tree& tree);
+    void repair(const CsrGraph& g, Tree& tree, const vector<EdgeChange>& changes);
+    void settle(const CsrGraph& g, Tree& tree, vector<int>& seeds);
+
+public:
+    explicit DynamicSSSP(const RoadNetwork& g);
+
+    void add_hub(int id);
+    bool is_hub(int id) const;
+    const vector<int>& hubs() const;
+
+    void sync();
+    double distance(int hub, int target);
+    vector<int> path(int hub, int target);
+    size_t last_repaired() const;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef EPOCH_RECLAIM_HPP
+#define EPOCH_RECLAIM_HPP
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Epoch-based memory reclamation. A reader pins the current epoch for the
+// duration of a Guard; writers unlink an object and retire() it, tagging it
+// with the epoch it was unlinked in. The object is freed once every pinned
+// thread has moved past that epoch, so a reader that could still have loaded
+// the pointer never sees it freed. Guards nest on the same thread.
+class EpochDomain {
+public:
+    class Guard {
+    private:
+        EpochDomain* domain;
+
+    public:
+        explicit Guard(EpochDomain& d);
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    EpochDomain() = default;
+    ~EpochDomain();
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    void retire(void* ptr, void (*deleter)(void*));
+    size_t pending() const;
+
+    static EpochDomain& global();
+
+private:
+    static constexpr size_t MAX_THREADS = 128;
+    static constexpr size_t RECLAIM_BATCH = 64;
+
+    struct alignas(64) Record {
+        atomic<uint64_t> epoch{0};
+        atomic<bool> owned{false};
+    };
+
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    Record records[MAX_THREADS];
+    atomic<uint64_t> global_epoch{1};
+    mutable mutex retired_mtx;
+    vector<Retired> retired;
+
+    size_t claim_record();
+    void release_record(size_t slot);
+    void enter();
+    void leave();
+    void reclaim();
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef GRID_INDEX_HPP
+#define GRID_INDEX_HPP
+
+#include "spatial_index.hpp"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+// Hashed uniform grid over vehicle positions, for dense, evenly spread
+// fleets where a quadtree keeps subdividing. Only occupied cells are stored.
+// Each cell keeps x/y arrays next to its items for the distance kernels, and
+// a vehicle ID maps to its (cell, slot), so a move is a swap-remove plus an
+// append. Nearest search scans square rings of cells outwards from the query
+// cell until the k-th best candidate is closer than any unscanned ring; once
+// a ring would hold more cells than are occupied, it walks the remaining
+// occupied cells instead, so empty space is never scanned cell by cell.
+class GridIndex : public VehicleIndex {
+private:
+    struct Cell {
+        vector<Item> items;
+        vector<double> xs, ys;
+    };
+
+    struct Slot {
+        int64_t cell;
+        size_t index;
+    };
+
+    double cell_size;
+    unordered_map<int64_t, Cell> cells;
+    unordered_map<int, Slot> slot_of;
+    int32_t min_cx = 0, min_cy = 0, max_cx = -1, max_cy = -1;
+
+    int32_t coord(double v) const;
+    static int64_t key(int32_t cx, int32_t cy);
+    void add(Location* loc, Vehicle* veh);
+    void erase(const Slot& slot);
+    void scan_cell(const Cell& cell, double x, double y, size_t k, const ItemFilter& filter,
+                   vector<pair<double, Item>>& best, vector<double>& dist) const;
+    void nearest(double x, double y, size_t k, const ItemFilter& filter,
+                 vector<pair<double, Item>>& best, vector<double>& dist) const;
+
+public:
+    explicit GridIndex(double cell_size);
+
+    void insert_vehicle(Vehicle* veh) override;
+    void update_vehicle_position(int veh_id, double new_x, double new_y) override;
+    bool remove_vehicle(int veh_id) override;
+    vector<Item> query_radius(double x, double y, double radius) const override;
+    vector<Item> k_nearest(double x, double y, size_t k, const ItemFilter& filter = nullptr) const override;
+    Item find_nearest_vehicle(double x, double y) const override;
+    void k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k, const BatchFilter& filter,
+                         vector<size_t>& offsets, vector<Item>& out) const override;
+};
+
+#endif
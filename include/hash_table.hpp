@@ -2,33 +2,108 @@
 #define HASH_TABLE_HPP
 
 #include <vector>
-#include <list>
+#include <deque>
 #include <functional>
 #include <optional>
 #include <string>
+#include <cstdint>
+#include <type_traits>
+#include <iterator>
+#include <utility>
+#include <cstddef>
 #include "types.hpp"
 
 using namespace std;
 
-template<typename K, typename V>
+// Open-addressing hash table in the Swiss-table style. One control byte per
+// slot holds either EMPTY, DELETED or the low 7 bits of the key's hash, and
+// lookups scan the control bytes 16 at a time (SSE2 where available) so only
+// slots whose tag matches are compared. Slots store an index into a node
+// store that never moves, so V* returned by find() stays valid across
+// inserts and rehashes until that key is removed. Iteration walks the node
+// store directly, in insertion order with removed entries skipped.
+template<typename K, typename V, typename Hash = hash<K>>
 class HashTable {
 private:
+    struct Entry {
+        K key;
+        V value;
+        bool live;
+    };
+
+    // Yields (const key, value) pairs by value; the key and the internal
+    // liveness flag cannot be written through an iterator.
+    template<bool Const>
+    class Iter {
+    private:
+        using Store = conditional_t<Const, const deque<Entry>, deque<Entry>>;
+        Store* store;
+        size_t pos;
+
+        void skip() {
+            while (pos < store->size() && !(*store)[pos].live) ++pos;
+        }
+
+    public:
+        using iterator_category = input_iterator_tag;
+        using value_type = pair<const K, V>;
+        using difference_type = ptrdiff_t;
+        using reference = pair<const K&, conditional_t<Const, const V&, V&>>;
+
+        struct pointer {
+            reference ref;
+            const reference* operator->() const { return &ref; }
+        };
+
+        Iter(Store* s, size_t p) : store(s), pos(p) { skip(); }
+        reference operator*() const { return reference((*store)[pos].key, (*store)[pos].value); }
+        pointer operator->() const { return pointer{**this}; }
+        Iter& operator++() { ++pos; skip(); return *this; }
+        Iter operator++(int) { Iter old = *this; ++*this; return old; }
+        bool operator==(const Iter& o) const { return pos == o.pos; }
+        bool operator!=(const Iter& o) const { return pos != o.pos; }
+    };
+
     static constexpr size_t DEFAULT_SIZE = 101;
-    vector<list<pair<K, V>>> table;
+    static constexpr size_t GROUP_WIDTH = 16;
+
+    vector<int8_t> ctrl;
+    vector<size_t> slots;
+    deque<Entry> nodes;
+    vector<size_t> free_nodes;
     size_t num_elements = 0;
-    function<size_t(const K&)> hash_func;
-    size_t get_index(const K& key) const;
-    void rehash();
+    size_t tombstones = 0;
+    Hash hash_func;
+
+    size_t hash_of(const K& key) const;
+    long find_slot(const K& key, size_t h) const;
+    size_t find_insert_slot(size_t h) const;
+    void rehash(size_t new_capacity);
 
 public:
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
     HashTable();
-    HashTable(size_t initial_size, function<size_t(const K&)> hasher);
+    explicit HashTable(size_t initial_size, Hash hasher = Hash());
     void insert(const K& key, V value);
     optional<V*> find(const K& key);
     optional<const V*> find(const K& key) const;
     bool remove(const K& key);
     size_t size() const;
     bool empty() const;
+    void clear();
+
+    void reserve(size_t count);
+    void insert_many(vector<pair<K, V>> items);
+    vector<pair<K, V>> extract_all();
+    void for_each(const function<void(const K&, V&)>& fn);
+    void for_each(const function<void(const K&, const V&)>& fn) const;
+
+    iterator begin() { return iterator(&nodes, 0); }
+    iterator end() { return iterator(&nodes, nodes.size()); }
+    const_iterator begin() const { return const_iterator(&nodes, 0); }
+    const_iterator end() const { return const_iterator(&nodes, nodes.size()); }
 };
 
-#endif
\ No newline at end of file
+#endif
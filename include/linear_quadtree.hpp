@@ -0,0 +1,54 @@
+#ifndef LINEAR_QUADTREE_HPP
+#define LINEAR_QUADTREE_HPP
+
+#include "types.hpp"
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+using namespace std;
+
+// Pointer-free quadtree for large, mostly static location sets. Items are
+// sorted by the Morton (Z-order) code of their quantized position and stored
+// once, flat, with x/y kept in separate arrays next to the Location pointers.
+// Nodes live in one pool; the four children of a node are contiguous, and
+// every node covers a contiguous range of the item arrays, so a leaf scan is
+// a sequential walk. Inserts are buffered until build() lays them out;
+// queries only see built items and never modify the tree, so any number of
+// threads may query between writes.
+class LinearQuadTree {
+public:
+    using LocationFilter = function<bool(const Location*)>;
+
+private:
+    static constexpr uint32_t LEAF_SIZE = 16;
+    static constexpr int LEVELS = 16;
+
+    struct Node {
+        double min_x, min_y, max_x, max_y;
+        uint32_t begin, end;
+        uint32_t first_child;
+    };
+
+    double min_x, min_y, max_x, max_y;
+    vector<Location*> pending;
+    vector<Node> nodes;
+    vector<double> xs;
+    vector<double> ys;
+    vector<Location*> items;
+
+    uint64_t morton(double x, double y) const;
+    void build_node(uint32_t idx, const vector<uint64_t>& codes, int level);
+    double box_dist2(const Node& n, double x, double y) const;
+
+public:
+    LinearQuadTree(double minx, double miny, double maxx, double maxy);
+
+    void insert_location(Location* loc);
+    void build();
+    size_t size() const;
+    vector<Location*> query_radius(double x, double y, double radius) const;
+    vector<Location*> k_nearest(double x, double y, size_t k, const LocationFilter& filter = nullptr) const;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef PARALLEL_SSSP_HPP
+#define PARALLEL_SSSP_HPP
+
+#include "csr_graph.hpp"
+#include "thread_pool.hpp"
+#include <vector>
+
+using namespace std;
+
+class RoadNetwork;
+
+// Delta-stepping single-source shortest paths on the CSR graph. Nodes are
+// bucketed by floor(dist / delta); each bucket is drained by repeated
+// parallel light-edge (w <= delta) relaxation rounds over a compacted
+// frontier, followed by one parallel heavy-edge round. Distances are updated
+// with an atomic compare-and-swap minimum. Results are indexed by the dense
+// CSR node index (RoadNetwork::csr().index_of). Weights must be non-negative.
+class ParallelSSSP {
+private:
+    const RoadNetwork& graph;
+    ThreadPool& pool;
+    double delta = 0.0;
+
+    double pick_delta(const CsrGraph& g) const;
+
+public:
+    explicit ParallelSSSP(const RoadNetwork& g, ThreadPool& p = ThreadPool::shared());
+
+    void set_delta(double d);
+    vector<double> run(int source);
+    vector<vector<double>> run_batch(const vector<int>& sources);
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef PATH_CACHE_HPP
+#define PATH_CACHE_HPP
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+// Bounded LRU cache of point-to-point results keyed by (start, goal). Keys
+// are spread over lock-striped shards, each with its own recency list and
+// an index from every edge to the cached paths that traverse it, so a
+// traffic change can drop exactly the entries whose path uses the edge;
+// invalidate_if() covers changes that can affect paths not using it. An
+// empty path with infinite cost records an unreachable goal.
+class PathCache {
+public:
+    struct Result {
+        vector<int> path;
+        double cost;
+        unsigned long epoch;
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t invalidations = 0;
+        size_t evictions = 0;
+        size_t size = 0;
+    };
+
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Slot {
+        uint64_t key;
+        Result result;
+    };
+
+    struct alignas(64) Shard {
+        mutable mutex mtx;
+        list<Slot> lru;
+        unordered_map<uint64_t, list<Slot>::iterator> index;
+        unordered_map<uint64_t, unordered_set<uint64_t>> by_edge;
+    };
+
+    Shard shards[SHARDS];
+    size_t per_shard;
+    atomic<size_t> hits{0};
+    atomic<size_t> misses{0};
+    atomic<size_t> invalidations{0};
+    atomic<size_t> evictions{0};
+
+    static uint64_t key_of(int a, int b);
+    Shard& shard_of(uint64_t key);
+    void unlink(Shard& shard, list<Slot>::iterator it);
+
+public:
+    explicit PathCache(size_t capacity = 4096);
+
+    PathCache(const PathCache&) = delete;
+    PathCache& operator=(const PathCache&) = delete;
+
+    bool lookup(int start, int goal, Result& out);
+    void store(int start, int goal, Result result);
+    size_t invalidate_edge(int from, int to);
+    size_t invalidate_if(const function<bool(int start, int goal, const Result&)>& stale);
+    double max_cost() const;
+    size_t size() const;
+    void clear();
+    Stats stats() const;
+};
+
+#endif
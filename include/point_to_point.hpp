@@ -0,0 +1,74 @@
+#ifndef POINT_TO_POINT_HPP
+#define POINT_TO_POINT_HPP
+
+#include "csr_graph.hpp"
+#include <vector>
+#include <queue>
+#include <utility>
+
+using namespace std;
+
+class RoadNetwork;
+
+enum class HeuristicMode { None, Euclidean, Landmarks };
+
+// Bidirectional A* over the frozen CSR graph. Each direction uses its own
+// consistent potential (Euclidean distance scaled by the smallest
+// weight/length ratio of any edge, and/or ALT landmark triangle bounds), and
+// the search stops once either queue's minimum key reaches the best meeting
+// cost found so far.
+class PointToPointRouter {
+private:
+    using P = pair<double, int>;
+    using MinQueue = priority_queue<P, vector<P>, greater<P>>;
+
+    struct Side {
+        vector<double> dist;
+        vector<double> pot;
+        vector<int> parent;
+        vector<unsigned> stamp;
+        MinQueue pq;
+    };
+
+    const RoadNetwork& graph;
+    HeuristicMode mode = HeuristicMode::Euclidean;
+
+    Side fwd, bwd;
+    unsigned cur_stamp = 0;
+    size_t settled = 0;
+
+    unsigned long seen_generation = 0;
+    unsigned long seen_epoch = 0;
+    bool prepared = false;
+    double euclid_scale = 0.0;
+
+    vector<int> landmark_ids;
+    size_t wanted_landmarks = 0;
+    size_t lm_count = 0;
+    vector<double> lm_from;
+    vector<double> lm_to;
+    vector<double> lm_weights;
+
+    void prepare();
+    void compute_scale(const CsrGraph& g);
+    void compute_landmarks(const CsrGraph& g);
+    bool landmarks_stale(const CsrGraph& g) const;
+    double potential(const CsrGraph& g, int v, int target, bool reverse) const;
+    void touch(Side& side, int v);
+    bool search(int s, int t, int& meet, double& best);
+
+public:
+    explicit PointToPointRouter(const RoadNetwork& g);
+
+    void set_mode(HeuristicMode m);
+    HeuristicMode get_mode() const;
+    void set_landmarks(const vector<int>& ids);
+    void select_landmarks(size_t count);
+    const vector<int>& landmarks() const;
+
+    vector<int> shortest_path(int start, int goal);
+    double distance(int start, int goal);
+    size_t last_settled() const;
+};
+
+#endif
@@ -4,27 +4,115 @@
 #include <vector>
 #include <functional>
 #include <utility>
+#include <limits>
+#include <cstdint>
 
 using namespace std;
 
-template<typename T, typename Compare = less<T>>
+// Indexed D-ary heap. comp(a, b) == true means a is served before b, so
+// less<T> gives a min-heap. push() returns a handle that stays attached to
+// the element however it moves inside the heap, until the element is popped
+// or erased; handles are then recycled. decrease_key() moves an element
+// towards the top, update() in either direction.
+template<typename T, typename Compare = less<T>, size_t D = 4>
 class PriorityQueue {
+public:
+    using Handle = size_t;
+    static constexpr Handle NONE = numeric_limits<size_t>::max();
+
 private:
-    vector<T> heap;
+    struct Slot {
+        T item;
+        Handle handle;
+    };
+
+    vector<Slot> heap;
+    vector<size_t> pos;
+    vector<Handle> free_handles;
     Compare comp;
 
-    void heapify_up(size_t idx);
-    void heapify_down(size_t idx);
+    Handle acquire();
+    void sift_up(size_t idx);
+    void sift_down(size_t idx);
+    void remove_at(size_t idx);
 
 public:
     PriorityQueue(Compare c = Compare()) : comp(c) {}
 
-    void push(T item);
+    Handle push(T item);
     T pop();
     const T& top() const;
+    Handle top_handle() const;
     bool empty() const;
     size_t size() const;
-    void update_priority(size_t index, const T& new_value); 
+
+    bool contains(Handle h) const;
+    const T& get(Handle h) const;
+    void update(Handle h, T new_value);
+    void decrease_key(Handle h, T new_value);
+    void erase(Handle h);
+
+    vector<Handle> heapify(vector<T> items);
+    void reserve(size_t n);
+    void clear();
+};
+
+// Dijkstra frontiers. Both take (node, tentative distance) and hand back the
+// closest pending node; a search selects one at compile time.
+//
+// HeapFrontier keeps one entry per node in the indexed heap and lowers it
+// with decrease_key.
+class HeapFrontier {
+private:
+    using Queue = PriorityQueue<pair<double, int>>;
+    Queue heap;
+    vector<Queue::Handle> handle;
+
+public:
+    explicit HeapFrontier(size_t nodes);
+    void push(int v, double d);
+    pair<double, int> pop();
+    bool empty() const;
+    void clear();
+};
+
+// RadixFrontier is a monotone radix heap keyed on the distance in fixed
+// point (SCALE units per weight unit). Pushes are O(1) and each entry moves
+// between buckets at most 64 times over its lifetime. Entries that share
+// the current minimum key sit in bucket 0, a binary heap on the exact
+// distance, so a pop costs O(log |bucket 0|) plus the amortized moves.
+// Improvements are re-pushed and the stale entry is returned later with its
+// old distance, which callers already skip via `cost > dist[u]`. A push
+// that breaks monotonicity (a negative edge weight reaching the frontier)
+// or has no key (negative, NaN, or past the fixed-point range) switches it
+// to a plain binary heap on the exact distance for the rest of the search,
+// i.e. to HeapFrontier's behaviour.
+class RadixFrontier {
+public:
+    static constexpr double SCALE = 1000.0;
+
+private:
+    struct Entry {
+        uint64_t key;
+        double dist;
+        int node;
+    };
+
+    vector<Entry> buckets[65];
+    uint64_t last = 0;
+    size_t count = 0;
+    bool exact = false;
+
+    static size_t bucket_of(uint64_t key, uint64_t last);
+    static bool farther(const Entry& a, const Entry& b);
+    void fall_back();
+
+public:
+    explicit RadixFrontier(size_t nodes = 0);
+    void push(int v, double d);
+    pair<double, int> pop();
+    bool empty() const;
+    void clear();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,38 +2,79 @@
 #define QUADTREE_HPP
 
 #include "types.hpp"
+#include "spatial_index.hpp"
 #include <vector>
 #include <memory>
 #include <optional>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
 
 using namespace std;
 
 struct QuadNode {
     double min_x, min_y, max_x, max_y;
     vector<pair<Location*, Vehicle*>> items;
+    vector<double> xs, ys;
     unique_ptr<QuadNode> children[4];
+    QuadNode* parent = nullptr;
     static constexpr int CAPACITY = 4;
 
     QuadNode(double mx, double my, double Mx, double My);
     bool contains(double px, double py) const;
+    void add(Location* loc, Vehicle* veh, double px, double py);
+    void erase_at(size_t i);
 };
 
-class QuadTree {
+// Point quadtree over locations and vehicles. Locations are placed by their
+// x/y, vehicles by current_x/current_y. Each vehicle's node is indexed by
+// ID, so a position update only moves that vehicle. If it is still inside
+// its node it stays put; otherwise it is reinserted from the lowest
+// ancestor that contains it. Subtrees left with at most CAPACITY items
+// after a removal are merged back into their parent. Each node keeps its
+// items' coordinates in xs/ys next to the items, and leaf scans run the
+// vectorized kernels from spatial_kernels.hpp over them; vehicle moves must
+// therefore go through update_vehicle_position.
+class QuadTree : public VehicleIndex {
 private:
+    struct NearestEntry {
+        double dist;
+        const QuadNode* node;
+        Item item;
+    };
+
+    struct NearestScratch {
+        vector<NearestEntry> heap;
+        vector<double> dist;
+    };
+
     unique_ptr<QuadNode> root;
+    unordered_map<int, QuadNode*> vehicle_node;
 
     void insert(QuadNode* node, Location* loc, Vehicle* veh = nullptr);
+    void place(QuadNode* node, Location* loc, Vehicle* veh);
     void subdivide(QuadNode* node);
-    void query(QuadNode* node, double x, double y, double radius, 
-               vector<pair<Location*, Vehicle*>>& result) const;
+    void merge_up(QuadNode* node);
+    bool detach(int veh_id);
+    void query(QuadNode* node, double x, double y, double radius,
+               vector<pair<Location*, Vehicle*>>& result, vector<uint32_t>& hits) const;
+    void nearest(double x, double y, size_t k, const ItemFilter& filter,
+                 vector<Item>& result, NearestScratch& scratch) const;
 
 public:
     QuadTree(double minx, double miny, double maxx, double maxy);
     void insert_location(Location* loc);
-    void insert_vehicle(Vehicle* veh);
-    void update_vehicle_position(int veh_id, double new_x, double new_y);
-    vector<pair<Location*, Vehicle*>> query_radius(double x, double y, double radius) const;
-    pair<Location*, Vehicle*> find_nearest_vehicle(double x, double y) const;
+    void insert_vehicle(Vehicle* veh) override;
+    void update_vehicle_position(int veh_id, double new_x, double new_y) override;
+    bool remove_vehicle(int veh_id) override;
+    vector<Item> query_radius(double x, double y, double radius) const override;
+    Item find_nearest_vehicle(double x, double y) const override;
+    vector<Item> k_nearest(double x, double y, size_t k, const ItemFilter& filter = nullptr) const override;
+
+    void k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k, const BatchFilter& filter,
+                         vector<size_t>& offsets, vector<Item>& out) const override;
+    void query_radius_batch(const double* qx, const double* qy, size_t m, double radius,
+                            vector<size_t>& offsets, vector<Item>& out) const override;
 };
 
 #endif
\ No newline at end of file
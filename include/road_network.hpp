@@ -2,6 +2,9 @@
 #define ROAD_NETWORK_HPP
 
 #include "types.hpp"
+#include "csr_graph.hpp"
+#include "path_cache.hpp"
+#include "travel_time.hpp"
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -10,24 +13,101 @@
 #include <algorithm>
 #include <utility>
 #include <set>
+#include <memory>
+#include <deque>
 
 using namespace std;
 
+class PointToPointRouter;
+class ContractionHierarchy;
+class DynamicSSSP;
+class HeapFrontier;
+class RadixFrontier;
+
+struct EdgeChange {
+    int from;
+    int to;
+    double old_weight;
+    double new_weight;
+    unsigned long epoch;
+};
+
+struct EdgeUpdate {
+    int from;
+    int to;
+    double weight;
+};
+
+enum class RoutingMode { Dijkstra, BidirectionalAStar, Landmarks, ContractionHierarchy };
+
 class RoadNetwork {
 private:
-    unordered_map<int, vector<Edge>> adj;
+    mutable unordered_map<int, vector<Edge>> adj;
+    mutable unordered_map<int, pair<double, double>> positions;
+    mutable bool adj_stale = false;
+    mutable CsrGraph frozen;
+    mutable bool frozen_dirty = true;
+    unsigned long epoch = 0;
+    RoutingMode mode = RoutingMode::Dijkstra;
+    mutable unique_ptr<PointToPointRouter> p2p;
+    mutable unique_ptr<ContractionHierarchy> cch;
+    mutable unique_ptr<DynamicSSSP> hub_trees;
+    deque<EdgeChange> change_log;
+    static constexpr size_t CHANGE_LOG_LIMIT = 4096;
+    static constexpr size_t SHORTCUT_LIMIT = 32;
+    static constexpr size_t SAMPLE_LIMIT = 256;
+    unsigned long trimmed_epoch = 0;
+    mutable PathCache paths;
+    TravelTimeTable::Samples traffic_samples;
+    mutable TravelTimeTable timed;
+    mutable bool timed_dirty = true;
+    double time_unit = 60.0;
+
+    vector<int> search_path(int start, int goal) const;
+    double path_weight(const vector<int>& path) const;
+    PathCache::Result cached_route(int start, int goal) const;
+    void invalidate_shortcut(int from, int to, double weight);
+    void thaw() const;
+    void log_change(const EdgeChange& change);
 
 public:
+    RoadNetwork();
+    ~RoadNetwork();
+
+    void reserve(size_t nodes);
+    void adopt(CsrGraph g);
     void add_edge(int from, int to, double weight);
     void update_edge_weight(int from, int to, double new_weight);
+    size_t update_edge_weights(const vector<EdgeUpdate>& updates);
     bool remove_edge(int from, int to);
+    void set_node_position(int id, double x, double y);
+    void set_routing_mode(RoutingMode m);
+    RoutingMode routing_mode() const;
+    PointToPointRouter& router() const;
+    ContractionHierarchy& hierarchy() const;
+    DynamicSSSP& hubs() const;
+    void add_hub(int id);
     vector<int> dijkstra(int start, int goal) const;
+    double shortest_distance(int start, int goal) const;
+    void add_traffic_sample(int from, int to, TimePoint at, double weight);
+    void set_time_unit(double seconds);
+    const TravelTimeTable& travel_times() const;
+    double edge_weight_at(int from, int to, TimePoint at) const;
+    TimedPath dijkstra_at(int start, int goal, TimePoint depart) const;
+    vector<TimePoint> arrivals_at(const vector<int>& stops, TimePoint depart) const;
+    PathCache& path_cache() const;
+    template<typename Frontier = HeapFrontier>
+    vector<int> dijkstra_search(int start, int goal) const;
     vector<double> bellman_ford(int start) const;
+    vector<vector<double>> bellman_ford_batch(const vector<int>& sources) const;
     void bfs(int start, unordered_set<int>& visited) const;
     void dfs(int node, vector<bool>& visited) const;
     vector<pair<int, int>> kruskal_mst() const;
     vector<int> topological_sort() const;
     const unordered_map<int, vector<Edge>>& get_adj() const;
+    const CsrGraph& csr() const;
+    unsigned long traffic_epoch() const;
+    bool changes_since(unsigned long since, vector<EdgeChange>& out) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,12 +3,76 @@
 
 #include "types.hpp"
 #include "road_network.hpp"
+#include "distance_matrix.hpp"
 #include <vector>
+#include <chrono>
+#include <utility>
 
 using namespace std;
 
+// Visiting order over a growing set of stops. The road costs between every
+// pair of stops are cached, so adding a stop takes one forward and one
+// backward search from it and otherwise only table lookups: the stop goes
+// where it adds the least cost, and its two new neighbours are then each
+// moved to their own cheapest position if that helps. Stop 0 is the fixed
+// start. Stops that cannot be reached in order are rejected. The table is
+// priced at one traffic epoch of the graph; refresh() (also run by insert())
+// re-queries it once the epoch has moved.
+//
+// improve() runs 2-opt and Or-opt (segments of one to three stops, moved
+// before or after a neighbour) over the same table. Candidate moves pair a
+// stop only with its NEIGHBOURS closest stops, and a don't-look bit skips
+// stops whose surroundings have not changed since they last failed to
+// improve; insert() clears the bits around the new stop. Neighbour lists
+// are built on the first improve() and then kept up to date per stop.
+class RoutePlan {
+public:
+    using Deadline = chrono::steady_clock::time_point;
+
+private:
+    static constexpr size_t NEIGHBOURS = 8;
+
+    vector<int> nodes;
+    vector<vector<double>> costs;
+    vector<size_t> order;
+    vector<char> dont_look;
+    vector<vector<size_t>> near;
+    double total = 0.0;
+    unsigned long epoch = 0;
+
+    double leg(size_t a, size_t b) const;
+    size_t cheapest_position(size_t stop, double& delta) const;
+    bool relocate(size_t at);
+    void wake(size_t pos);
+    pair<double, size_t> rank(size_t a, size_t b) const;
+    vector<size_t> closest_to(size_t a) const;
+    void build_neighbours();
+    void link_neighbours(size_t idx);
+    void unlink_neighbours(size_t k);
+    bool try_two_opt(size_t i, size_t j, const vector<double>& fwd, const vector<double>& bwd);
+    bool try_or_opt(size_t i, size_t j);
+    double recompute_total() const;
+
+public:
+    RoutePlan() = default;
+    explicit RoutePlan(int start);
+
+    bool empty() const;
+    int start() const;
+    size_t size() const;
+    double cost() const;
+    bool refresh(const RoadNetwork& graph);
+    bool insert(const RoadNetwork& graph, int stop, bool repair = true);
+    bool erase(int stop);
+    bool needs_improvement() const;
+    bool improve(Deadline deadline);
+    vector<int> stops() const;
+    vector<double> arrivals() const;
+};
+
 vector<int> greedy_route(const RoadNetwork& graph, int start, const vector<int>& destinations);
+vector<int> greedy_route(const DistanceMatrix& matrix, int start, const vector<int>& destinations);
 double route_cost(const RoadNetwork& graph, const vector<int>& path);
-vector<vector<int>> partition_deliveries(const vector<Delivery>& deliveries, int num_vehicles);
+double route_cost(const DistanceMatrix& matrix, const vector<int>& path);
 
 #endif
\ No newline at end of file
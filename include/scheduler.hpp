@@ -4,29 +4,55 @@
 #include "types.hpp"
 #include "priority_queue.hpp"
 #include "quadtree.hpp"
+#include "linear_quadtree.hpp"
+#include "grid_index.hpp"
 #include "hash_table.hpp"
+#include "concurrent_hash_table.hpp"
 #include "road_network.hpp"
 #include "delivery.hpp"
 #include "route_optimizer.hpp"
+#include "assignment.hpp"
+#include "vrp.hpp"
+#include "traffic_feed.hpp"
 #include <vector>
 #include <unordered_map>
 #include <optional>
+#include <memory>
 
 using namespace std;
 
+// Batch dispatch: each tick matches a window of pending deliveries to their
+// nearest candidate vehicles in one min-cost assignment over road-network
+// distances, then spends up to improve_budget on local search over the
+// routes that changed.
+struct DispatchOptions {
+    size_t window = 256;
+    size_t candidates = 8;
+    chrono::microseconds improve_budget{2000};
+};
+
 class Scheduler {
 private:
     RoadNetwork& graph;
     HashTable<int, Location>& location_db;
-    QuadTree location_qt;
-    QuadTree vehicle_qt;
-    HashTable<int, Delivery> delivery_db;
-    HashTable<int, Vehicle> vehicle_db;
+    LinearQuadTree location_qt;
+    unique_ptr<VehicleIndex> vehicle_qt;
+    VehicleIndexKind index_kind = VehicleIndexKind::QuadTree;
+    ConcurrentHashTable<int, Delivery> delivery_db;
+    // vehicle_qt points into vehicle_db's entries. Vehicles are only added
+    // or replaced through add_vehicle(), which re-points the index, so
+    // callers of get_vehicle_db() must not insert or remove.
+    ConcurrentHashTable<int, Vehicle> vehicle_db;
     DeliveryPQ pending;
+    unordered_map<int, RoutePlan> route_plans;
+    TrafficFeed* traffic_feed = nullptr;
 
     double qt_min_x, qt_min_y, qt_max_x, qt_max_y;
 
-    void rebuild_vehicle_qt();
+    void publish_route(Vehicle* veh, const RoutePlan& plan);
+    void sync_traffic();
+    vector<Delivery> next_window(size_t size);
+    size_t dispatch_window(vector<Delivery>& window, size_t candidates);
 
 public:
     Scheduler(RoadNetwork& g, HashTable<int, Location>& loc_db,
@@ -35,18 +61,28 @@ public:
     void add_delivery(Delivery del);
     void add_vehicle(Vehicle veh);
     void add_location_to_quadtree(Location* loc);
+    void build_location_index();
+    void set_vehicle_index(VehicleIndexKind kind, double cell_size = 10.0);
+    VehicleIndexKind vehicle_index() const;
 
     void update_vehicle_position(int veh_id, double new_x, double new_y);
 
-    pair<Location*, Vehicle*> find_nearest_vehicle(double x, double y);
-    void assign_delivery(int del_id, int veh_id);
+    pair<Location*, Vehicle*> find_nearest_vehicle(double x, double y, double load = 0.0);
+    bool assign_delivery(int del_id, int veh_id);
     void process_deliveries();
+    size_t dispatch_tick(const DispatchOptions& opts = DispatchOptions());
+    void process_deliveries_batch(const DispatchOptions& opts = DispatchOptions());
+
+    size_t improve_routes(chrono::microseconds budget);
+    size_t plan_routes(const VrpOptions& opts = VrpOptions());
+    vector<TimePoint> route_arrivals(int veh_id, TimePoint depart) const;
 
     void update_traffic(int from, int to, double new_weight);
+    void set_traffic_feed(TrafficFeed* feed);
     
     vector<Delivery> sorted_deliveries() const;
-    HashTable<int, Vehicle>& get_vehicle_db();
-    const HashTable<int, Vehicle>& get_vehicle_db() const;
+    ConcurrentHashTable<int, Vehicle>& get_vehicle_db();
+    const ConcurrentHashTable<int, Vehicle>& get_vehicle_db() const;
 
     struct Stats {
         int total_deliveries = 0;
@@ -0,0 +1,30 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "types.hpp"
+#include "road_network.hpp"
+#include "hash_table.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+// Binary image of the static inputs: the road network in its frozen CSR form
+// (positions included), the location table and the fleet. The file is a
+// fixed header, a section table and 8-byte aligned arrays in host layout;
+// a 64-bit checksum covers everything after the header. Loading maps the
+// file and copies each array in bulk, so there is no per-record parsing.
+// Location names and types are interned into one string pool.
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+// Returns false if the file cannot be written.
+bool write_snapshot(const string& filename, const RoadNetwork& graph, const vector<Location*>& all_locs,
+                    const HashTable<int, Vehicle>& vehicle_db, const vector<int>& vehicle_ids);
+
+// Returns false if the file cannot be opened; throws runtime_error if it is
+// not a snapshot of this version and host layout, or fails its checksum.
+bool load_snapshot(const string& filename, RoadNetwork& graph, HashTable<int, Location>& loc_db,
+                   vector<Location*>& all_locs, HashTable<int, Vehicle>& vehicle_db, vector<int>& vehicle_ids);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include "types.hpp"
+#include <vector>
+#include <functional>
+#include <utility>
+
+using namespace std;
+
+enum class VehicleIndexKind { QuadTree, Grid };
+
+// Moving-vehicle index used by Scheduler. Vehicles are positioned by
+// current_x/current_y; the Location in each item is the vehicle's
+// current_pos. Implementations own the coordinates they index, so moves
+// must go through update_vehicle_position.
+class VehicleIndex {
+public:
+    using Item = pair<Location*, Vehicle*>;
+    using ItemFilter = function<bool(const Location*, const Vehicle*)>;
+    using BatchFilter = function<bool(size_t query, const Location*, const Vehicle*)>;
+
+    virtual ~VehicleIndex() = default;
+
+    virtual void insert_vehicle(Vehicle* veh) = 0;
+    virtual void update_vehicle_position(int veh_id, double new_x, double new_y) = 0;
+    virtual bool remove_vehicle(int veh_id) = 0;
+    virtual vector<Item> query_radius(double x, double y, double radius) const = 0;
+    virtual vector<Item> k_nearest(double x, double y, size_t k, const ItemFilter& filter = nullptr) const = 0;
+    virtual Item find_nearest_vehicle(double x, double y) const = 0;
+
+    // Batch forms for m query points at once. Results go to caller-owned
+    // buffers that are reused across calls: the hits of query i are
+    // out[offsets[i], offsets[i + 1]), nearest first for k_nearest_batch.
+    // The defaults loop over the single-point queries; implementations
+    // override them to share their search scratch across the batch.
+    virtual void k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k,
+                                 const BatchFilter& filter, vector<size_t>& offsets, vector<Item>& out) const;
+    virtual void query_radius_batch(const double* qx, const double* qy, size_t m, double radius,
+                                    vector<size_t>& offsets, vector<Item>& out) const;
+};
+
+inline void VehicleIndex::k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k,
+                                          const BatchFilter& filter, vector<size_t>& offsets,
+                                          vector<Item>& out) const {
+    offsets.resize(m + 1);
+    out.clear();
+    for (size_t i = 0; i < m; ++i) {
+        offsets[i] = out.size();
+        ItemFilter one;
+        if (filter) one = [&filter, i](const Location* loc, const Vehicle* veh) { return filter(i, loc, veh); };
+        vector<Item> found = k_nearest(qx[i], qy[i], k, one);
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    offsets[m] = out.size();
+}
+
+inline void VehicleIndex::query_radius_batch(const double* qx, const double* qy, size_t m, double radius,
+                                             vector<size_t>& offsets, vector<Item>& out) const {
+    offsets.resize(m + 1);
+    out.clear();
+    for (size_t i = 0; i < m; ++i) {
+        offsets[i] = out.size();
+        vector<Item> found = query_radius(qx[i], qy[i], radius);
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    offsets[m] = out.size();
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SPATIAL_KERNELS_HPP
+#define SPATIAL_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// Distance kernels over structure-of-arrays coordinates, shared by the
+// spatial indexes for their leaf scans. The AVX2 path is picked at runtime
+// when the CPU supports it, SSE2 is the x86-64 baseline, and other targets
+// get the scalar loop.
+
+// out[i] = squared distance from (x, y) to (xs[i], ys[i]).
+void dist2_kernel(const double* xs, const double* ys, size_t n, double x, double y, double* out);
+
+// Writes the indices i with squared distance <= r2 to hits, in order, and
+// returns how many there were. hits must have room for n entries.
+size_t within_kernel(const double* xs, const double* ys, size_t n, double x, double y, double r2, uint32_t* hits);
+
+#endif
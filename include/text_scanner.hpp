@@ -0,0 +1,73 @@
+#ifndef TEXT_SCANNER_HPP
+#define TEXT_SCANNER_HPP
+
+#include "types.hpp"
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+using namespace std;
+
+// Read-only view of a whole file. Regular files are memory-mapped; anything
+// that cannot be mapped (pipes, empty files, platforms without mmap) is read
+// into an owned buffer instead.
+class MappedFile {
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    bool opened = false;
+    string buffer;
+
+public:
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const;
+    const char* data() const;
+    size_t size() const;
+    string_view text() const;
+};
+
+// Splits text into lines in place; a trailing '\r' is dropped.
+class LineReader {
+private:
+    const char* cur;
+    const char* end;
+
+public:
+    explicit LineReader(string_view text);
+    bool next(string_view& line);
+};
+
+// Whitespace-separated fields of one line, parsed in place with from_chars.
+// A read fails unless the whole field converts; fields past the last read
+// are ignored.
+class FieldReader {
+private:
+    const char* cur;
+    const char* end;
+
+    string_view token();
+
+public:
+    explicit FieldReader(string_view line);
+
+    bool read(int& out);
+    bool read(double& out);
+    bool read(string_view& out);
+    bool read(string& out);
+};
+
+size_t count_lines(string_view text);
+
+// YYYY-MM-DDTHH:MM:SS with optional fractional seconds and an optional 'Z'
+// or +HH:MM / -HH:MM offset. Without an offset the time is local, as
+// mktime() reads it; with one it is converted without consulting the time
+// zone database.
+bool parse_iso8601(string_view text, TimePoint& out);
+
+#endif
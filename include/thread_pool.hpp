@@ -0,0 +1,50 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstddef>
+
+using namespace std;
+
+// Fixed set of persistent worker threads. run() executes a task once on
+// every worker (the calling thread acts as worker 0) and blocks until all
+// of them return; parallel_for() hands out [begin, end) chunks dynamically.
+// Calls from different threads are serialized, and a run() issued from
+// inside a running task executes inline as worker 0 only. An exception
+// thrown by the task on any worker is rethrown from run() once all of them
+// have returned.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    mutex mtx;
+    mutex run_mtx;
+    condition_variable work_cv;
+    condition_variable done_cv;
+    const function<void(size_t)>* job = nullptr;
+    unsigned long round = 0;
+    size_t running = 0;
+    bool stopping = false;
+    exception_ptr failure;
+
+    void worker_loop(size_t id);
+
+public:
+    explicit ThreadPool(size_t threads = thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const;
+    void run(const function<void(size_t)>& task);
+    void parallel_for(size_t count, size_t grain, const function<void(size_t, size_t, size_t)>& body);
+
+    static ThreadPool& shared();
+};
+
+#endif
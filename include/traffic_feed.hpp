@@ -0,0 +1,109 @@
+#ifndef TRAFFIC_FEED_HPP
+#define TRAFFIC_FEED_HPP
+
+#include "types.hpp"
+#include "road_network.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// A batch stays open for `window` after its first update; `poll` is how
+// long the reader sleeps when the source has nothing new.
+struct FeedOptions {
+    chrono::milliseconds window{100};
+    chrono::milliseconds poll{20};
+};
+
+// Streaming ingestion of "from to weight timestamp" lines from a file that
+// keeps growing (or a pipe). A reader thread tails the source and coalesces
+// updates per edge, the last one winning, into batches sealed after
+// FeedOptions::window. The graph is never touched from that thread: the
+// dispatch thread calls apply_pending() at a safe point, which folds every
+// sealed batch into one RoadNetwork::update_edge_weights() call, i.e. one
+// epoch and one re-customization. Lag is measured from the arrival of a
+// batch's first line to its application.
+class TrafficFeed {
+public:
+    struct Stats {
+        size_t lines = 0;
+        size_t malformed = 0;
+        size_t updates = 0;
+        size_t coalesced = 0;
+        size_t batches = 0;
+        size_t applied = 0;
+        double mean_lag_ms = 0.0;
+        double max_lag_ms = 0.0;
+        double updates_per_second = 0.0;
+    };
+
+private:
+    class Source;
+
+    struct Update {
+        int from;
+        int to;
+        double weight;
+        TimePoint at;
+        bool timed;
+    };
+
+    struct Batch {
+        vector<Update> updates;
+        chrono::steady_clock::time_point opened;
+    };
+
+    string path;
+    FeedOptions opts;
+    unique_ptr<Source> source;
+    thread reader;
+    atomic<bool> stopping{false};
+    chrono::steady_clock::time_point started;
+
+    Batch open;
+    unordered_map<uint64_t, size_t> open_slot;
+
+    mutable mutex mtx;
+    deque<Batch> sealed;
+    atomic<size_t> sealed_count{0};
+    size_t batches_applied = 0;
+    size_t edges_applied = 0;
+    double lag_total_ms = 0.0;
+    double lag_max_ms = 0.0;
+
+    atomic<size_t> lines{0};
+    atomic<size_t> malformed{0};
+    atomic<size_t> updates{0};
+    atomic<size_t> coalesced{0};
+
+    void run();
+    bool pump(string& partial, vector<char>& chunk);
+    void ingest(string_view line);
+    void seal();
+
+public:
+    explicit TrafficFeed(string path, FeedOptions opts = FeedOptions());
+    ~TrafficFeed();
+
+    TrafficFeed(const TrafficFeed&) = delete;
+    TrafficFeed& operator=(const TrafficFeed&) = delete;
+
+    bool start();
+    void stop();
+    bool running() const;
+    bool has_pending() const;
+    size_t apply_pending(RoadNetwork& graph);
+    Stats stats() const;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TRAVEL_TIME_HPP
+#define TRAVEL_TIME_HPP
+
+#include "types.hpp"
+#include "csr_graph.hpp"
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Departure-time-dependent edge weights as piecewise-linear functions,
+// compiled against a CsrGraph: the breakpoints of the edge in CSR slot k
+// occupy [offsets[k], offsets[k+1]) of times/values, stored contiguously and
+// sorted by time. Times are seconds since the epoch; values are in weight
+// units, each worth seconds_per_unit seconds of travel. Outside the sampled
+// span a profile is held constant, and edges without samples keep their
+// static weight.
+//
+// Profiles are made FIFO when compiled: a value may fall no faster than the
+// clock advances, so departing later never means arriving earlier and a
+// label-setting search stays exact.
+class TravelTimeTable {
+private:
+    vector<size_t> offsets;
+    vector<double> times;
+    vector<double> values;
+    double seconds_per_unit = 60.0;
+
+public:
+    using Samples = unordered_map<uint64_t, vector<pair<double, double>>>;
+
+    static uint64_t edge_key(int from, int to);
+    static double seconds(TimePoint t);
+
+    void build(const CsrGraph& g, const Samples& samples, double unit_seconds);
+    void clear();
+    bool empty() const;
+    size_t breakpoints() const;
+    double unit_seconds() const;
+    double evaluate(size_t slot, double t, double fallback) const;
+};
+
+struct TimedPath {
+    vector<int> path;
+    TimePoint departure;
+    TimePoint arrival;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef VRP_HPP
+#define VRP_HPP
+
+#include "types.hpp"
+#include "hash_table.hpp"
+#include "road_network.hpp"
+#include "route_optimizer.hpp"
+#include "thread_pool.hpp"
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+// Arrival times are timed from start_time by RoadNetwork::arrivals_at(), so
+// each leg is priced with the traffic expected when it starts. A
+// vehicle's cluster may hold up to (1 + balance_slack) times its share of
+// the total weight, where shares are proportional to free capacity.
+// improve_budget is spent on each vehicle's route separately.
+struct VrpOptions {
+    TimePoint start_time = chrono::system_clock::now();
+    bool check_deadlines = true;
+    double balance_slack = 0.1;
+    chrono::microseconds improve_budget{50000};
+};
+
+// Per-vehicle results are indexed like the input vehicles. Delivery ids are
+// listed in visiting order, and plans[v].stops() is the route.
+struct VrpSolution {
+    vector<vector<int>> deliveries;
+    vector<RoutePlan> plans;
+    vector<double> loads;
+    vector<int> unassigned;
+};
+
+// Capacitated routing construction by sweep clustering. Drop-off points
+// are ordered by their angle around the centroid of the vehicles, starting
+// after the widest angular gap, and dealt in that order to the vehicles
+// (also taken by angle) until each reaches its balanced share; deliveries
+// that overflowed are then placed best-fit by remaining capacity. Each
+// cluster is routed in parallel by cheapest insertion in deadline order,
+// dropping any delivery whose insertion makes a stop late, and then
+// improved by local search as long as that keeps every stop on time.
+// Deliveries without a known drop-off location, that fit no vehicle or
+// that cannot be served on time are returned in `unassigned`.
+VrpSolution solve_vrp(const RoadNetwork& graph, const HashTable<int, Location>& locations,
+                      const vector<Vehicle>& vehicles, const vector<Delivery>& deliveries,
+                      const VrpOptions& opts = VrpOptions(), ThreadPool& pool = ThreadPool::shared());
+
+#endif
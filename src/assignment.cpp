@@ -0,0 +1,161 @@
+#include "../include/assignment.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr long PENDING = -2;
+constexpr long DUMMY = -1;
+constexpr size_t GRAIN = 64;
+
+struct Bid {
+    long arc;
+    double amount;
+};
+
+}
+
+SparseCostMatrix::SparseCostMatrix(size_t columns) : num_cols(columns) {}
+
+void SparseCostMatrix::add_arc(int col, double cost) {
+    cols.push_back(col);
+    costs.push_back(cost);
+}
+
+void SparseCostMatrix::end_row() {
+    offsets.push_back(cols.size());
+}
+
+size_t SparseCostMatrix::rows() const {
+    return offsets.size() - 1;
+}
+
+AssignmentResult auction_assign(const SparseCostMatrix& matrix, double unassigned_cost, ThreadPool& pool) {
+    size_t n = matrix.rows();
+    size_t m = matrix.num_cols;
+    AssignmentResult result;
+    result.col_of_row.assign(n, AssignmentResult::UNASSIGNED);
+    if (n == 0) return result;
+
+    // Square the problem so that a perfect matching always exists: object
+    // m + i is "row i stays unassigned" (cost unassigned_cost), and person
+    // n + j is "column j stays unused", which can take column j itself or
+    // the unassigned object of any row that has an arc to j (cost 0).
+    size_t people = n + m;
+    vector<size_t> offsets(people + 1, 0);
+    for (size_t i = 0; i < n; ++i) offsets[i + 1] = matrix.offsets[i + 1] - matrix.offsets[i] + 1;
+    for (size_t j = 0; j < m; ++j) offsets[n + j + 1] = 1;
+    for (int j : matrix.cols) ++offsets[n + j + 1];
+    for (size_t p = 0; p < people; ++p) offsets[p + 1] += offsets[p];
+
+    vector<int> objects(offsets[people]);
+    vector<double> costs(offsets[people], 0.0);
+    vector<long> origin(offsets[people], DUMMY);
+    vector<size_t> fill_at(offsets.begin(), offsets.end() - 1);
+    double max_cost = fabs(unassigned_cost);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t a = matrix.offsets[i]; a < matrix.offsets[i + 1]; ++a) {
+            int j = matrix.cols[a];
+            size_t k = fill_at[i]++;
+            objects[k] = j;
+            costs[k] = matrix.costs[a];
+            origin[k] = static_cast<long>(a);
+            max_cost = max(max_cost, fabs(matrix.costs[a]));
+            objects[fill_at[n + j]++] = static_cast<int>(m + i);
+        }
+        size_t k = fill_at[i]++;
+        objects[k] = static_cast<int>(m + i);
+        costs[k] = unassigned_cost;
+    }
+    for (size_t j = 0; j < m; ++j) objects[fill_at[n + j]++] = static_cast<int>(j);
+
+    double eps_final = max(max_cost, 1e-9) * 1e-7;
+    double eps = max(max_cost / 4.0, eps_final);
+
+    // Benefits are negated costs. Prices carry over between scaling phases;
+    // assignments are rebuilt from scratch in each.
+    vector<double> price(people, 0.0);
+    vector<long> owner(people);
+    vector<long> arc_of(people);
+    vector<size_t> bidders, next;
+    vector<Bid> bids;
+    vector<long> top_bidder(people, -1);
+    vector<double> top_amount(people);
+    vector<int> touched;
+
+    while (true) {
+        fill(owner.begin(), owner.end(), -1);
+        fill(arc_of.begin(), arc_of.end(), PENDING);
+        bidders.resize(people);
+        for (size_t p = 0; p < people; ++p) bidders[p] = p;
+
+        while (!bidders.empty()) {
+            bids.resize(bidders.size());
+            pool.parallel_for(bidders.size(), GRAIN, [&](size_t begin, size_t end, size_t) {
+                for (size_t k = begin; k < end; ++k) {
+                    size_t p = bidders[k];
+                    double best = -numeric_limits<double>::infinity();
+                    double second = best;
+                    size_t best_arc = offsets[p];
+                    for (size_t a = offsets[p]; a < offsets[p + 1]; ++a) {
+                        double v = -costs[a] - price[objects[a]];
+                        if (v > best) {
+                            second = best;
+                            best = v;
+                            best_arc = a;
+                        } else if (v > second) {
+                            second = v;
+                        }
+                    }
+                    // A single option is bid up by eps only; nobody else
+                    // competes for it on this person's behalf.
+                    double raise = isinf(second) ? 0.0 : best - second;
+                    bids[k] = {static_cast<long>(best_arc), price[objects[best_arc]] + raise + eps};
+                }
+            });
+
+            next.clear();
+            for (size_t k = 0; k < bidders.size(); ++k) {
+                int j = objects[bids[k].arc];
+                if (top_bidder[j] < 0) {
+                    touched.push_back(j);
+                } else if (bids[k].amount <= top_amount[j]) {
+                    next.push_back(bidders[k]);
+                    continue;
+                } else {
+                    next.push_back(bidders[top_bidder[j]]);
+                }
+                top_bidder[j] = static_cast<long>(k);
+                top_amount[j] = bids[k].amount;
+            }
+
+            for (int j : touched) {
+                size_t k = static_cast<size_t>(top_bidder[j]);
+                size_t winner = bidders[k];
+                if (owner[j] >= 0) {
+                    arc_of[owner[j]] = PENDING;
+                    next.push_back(static_cast<size_t>(owner[j]));
+                }
+                owner[j] = static_cast<long>(winner);
+                arc_of[winner] = bids[k].arc;
+                price[j] = top_amount[j];
+                top_bidder[j] = -1;
+            }
+            touched.clear();
+            bidders.swap(next);
+        }
+
+        if (eps <= eps_final) break;
+        eps = max(eps / 4.0, eps_final);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        long a = origin[arc_of[i]];
+        if (a == DUMMY) continue;
+        result.col_of_row[i] = matrix.cols[a];
+        result.total_cost += matrix.costs[a];
+        ++result.assigned;
+    }
+    return result;
+}
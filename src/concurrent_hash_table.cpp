@@ -0,0 +1,249 @@
+#include "../include/concurrent_hash_table.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// Marks a removed slot. Probes continue past it; inserts may reuse it.
+template<typename Node>
+Node* tombstone() {
+    return reinterpret_cast<Node*>(uintptr_t(1));
+}
+
+size_t capacity_for(size_t elements) {
+    size_t cap = 16;
+    while (cap / 2 < elements) cap *= 2;
+    return cap;
+}
+
+}
+
+template<typename K, typename V, typename Hash>
+ConcurrentHashTable<K, V, Hash>::Table::Table(size_t capacity)
+    : mask(capacity - 1), slots(new atomic<Node*>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) slots[i].store(nullptr, memory_order_relaxed);
+}
+
+template<typename K, typename V, typename Hash>
+ConcurrentHashTable<K, V, Hash>::ConcurrentHashTable(size_t initial_size, Hash hasher, EpochDomain& domain)
+    : hash_func(move(hasher)), epochs(domain) {
+    size_t per_shard = capacity_for((initial_size + SHARDS - 1) / SHARDS);
+    for (auto& shard : shards) {
+        shard.table.store(new Table(per_shard), memory_order_relaxed);
+    }
+}
+
+template<typename K, typename V, typename Hash>
+ConcurrentHashTable<K, V, Hash>::~ConcurrentHashTable() {
+    for (auto& shard : shards) {
+        Table* t = shard.table.load(memory_order_relaxed);
+        for (size_t i = 0; i <= t->mask; ++i) {
+            Node* n = t->slots[i].load(memory_order_relaxed);
+            if (n && n != tombstone<Node>()) delete n;
+        }
+        delete t;
+    }
+}
+
+template<typename K, typename V, typename Hash>
+size_t ConcurrentHashTable<K, V, Hash>::hash_of(const K& key) const {
+    uint64_t h = static_cast<uint64_t>(hash_func(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+template<typename K, typename V, typename Hash>
+typename ConcurrentHashTable<K, V, Hash>::Shard& ConcurrentHashTable<K, V, Hash>::shard_of(size_t h) {
+    return shards[h >> (64 - SHARD_BITS)];
+}
+
+template<typename K, typename V, typename Hash>
+const typename ConcurrentHashTable<K, V, Hash>::Shard& ConcurrentHashTable<K, V, Hash>::shard_of(size_t h) const {
+    return shards[h >> (64 - SHARD_BITS)];
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::grow_locked(Shard& shard, size_t min_live) {
+    Table* old = shard.table.load(memory_order_relaxed);
+    Table* next = new Table(max(capacity_for(min_live), old->mask + 1));
+
+    for (size_t i = 0; i <= old->mask; ++i) {
+        Node* n = old->slots[i].load(memory_order_relaxed);
+        if (!n || n == tombstone<Node>()) continue;
+        size_t j = hash_of(n->key) & next->mask;
+        while (next->slots[j].load(memory_order_relaxed)) j = (j + 1) & next->mask;
+        next->slots[j].store(n, memory_order_relaxed);
+    }
+
+    shard.table.store(next, memory_order_release);
+    shard.used = shard.live;
+    epochs.retire(old, [](void* p) { delete static_cast<Table*>(p); });
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::upsert_locked(Shard& shard, const K& key, size_t h, V value) {
+    Table* t = shard.table.load(memory_order_relaxed);
+    long reuse = -1;
+    size_t i = h & t->mask;
+
+    for (size_t probes = 0; probes <= t->mask; ++probes, i = (i + 1) & t->mask) {
+        Node* n = t->slots[i].load(memory_order_relaxed);
+        if (!n) break;
+        if (n == tombstone<Node>()) {
+            if (reuse < 0) reuse = static_cast<long>(i);
+            continue;
+        }
+        if (n->key == key) {
+            t->slots[i].store(new Node{key, move(value)}, memory_order_release);
+            epochs.retire(n, [](void* p) { delete static_cast<Node*>(p); });
+            return;
+        }
+    }
+
+    if (reuse < 0 && (shard.used + 1) * 2 > t->mask + 1) {
+        grow_locked(shard, shard.live + 1);
+        t = shard.table.load(memory_order_relaxed);
+        i = h & t->mask;
+        while (t->slots[i].load(memory_order_relaxed)) i = (i + 1) & t->mask;
+    } else if (reuse >= 0) {
+        i = static_cast<size_t>(reuse);
+    }
+
+    if (!t->slots[i].load(memory_order_relaxed)) ++shard.used;
+    t->slots[i].store(new Node{key, move(value)}, memory_order_release);
+    ++shard.live;
+    num_elements.fetch_add(1, memory_order_relaxed);
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::insert(const K& key, V value) {
+    size_t h = hash_of(key);
+    Shard& shard = shard_of(h);
+    lock_guard<mutex> lock(shard.mtx);
+    upsert_locked(shard, key, h, move(value));
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::insert_many(vector<pair<K, V>> items) {
+    vector<vector<pair<size_t, size_t>>> by_shard(SHARDS);
+    for (size_t i = 0; i < items.size(); ++i) {
+        size_t h = hash_of(items[i].first);
+        by_shard[h >> (64 - SHARD_BITS)].push_back({h, i});
+    }
+
+    for (size_t s = 0; s < SHARDS; ++s) {
+        if (by_shard[s].empty()) continue;
+        Shard& shard = shards[s];
+        lock_guard<mutex> lock(shard.mtx);
+        size_t want = shard.live + by_shard[s].size();
+        if (want * 2 > shard.table.load(memory_order_relaxed)->mask + 1) grow_locked(shard, want);
+        for (auto [h, i] : by_shard[s]) {
+            upsert_locked(shard, items[i].first, h, move(items[i].second));
+        }
+    }
+}
+
+// The caller must be pinned.
+template<typename K, typename V, typename Hash>
+typename ConcurrentHashTable<K, V, Hash>::Node* ConcurrentHashTable<K, V, Hash>::locate(const K& key) const {
+    size_t h = hash_of(key);
+    const Table* t = shard_of(h).table.load(memory_order_acquire);
+    size_t i = h & t->mask;
+
+    for (size_t probes = 0; probes <= t->mask; ++probes, i = (i + 1) & t->mask) {
+        Node* n = t->slots[i].load(memory_order_acquire);
+        if (!n) break;
+        if (n != tombstone<Node>() && n->key == key) return n;
+    }
+    return nullptr;
+}
+
+// The Ref pins before the probe's own guard is released, so there is no
+// window in which the node could be reclaimed.
+template<typename K, typename V, typename Hash>
+typename ConcurrentHashTable<K, V, Hash>::template Ref<V> ConcurrentHashTable<K, V, Hash>::find(const K& key) {
+    EpochDomain::Guard guard(epochs);
+    Node* n = locate(key);
+    return Ref<V>(epochs, n ? &n->value : nullptr);
+}
+
+template<typename K, typename V, typename Hash>
+typename ConcurrentHashTable<K, V, Hash>::template Ref<const V> ConcurrentHashTable<K, V, Hash>::find(const K& key) const {
+    EpochDomain::Guard guard(epochs);
+    const Node* n = locate(key);
+    return Ref<const V>(epochs, n ? &n->value : nullptr);
+}
+
+template<typename K, typename V, typename Hash>
+bool ConcurrentHashTable<K, V, Hash>::remove(const K& key) {
+    size_t h = hash_of(key);
+    Shard& shard = shard_of(h);
+    lock_guard<mutex> lock(shard.mtx);
+    Table* t = shard.table.load(memory_order_relaxed);
+    size_t i = h & t->mask;
+
+    for (size_t probes = 0; probes <= t->mask; ++probes, i = (i + 1) & t->mask) {
+        Node* n = t->slots[i].load(memory_order_relaxed);
+        if (!n) return false;
+        if (n != tombstone<Node>() && n->key == key) {
+            t->slots[i].store(tombstone<Node>(), memory_order_release);
+            --shard.live;
+            num_elements.fetch_sub(1, memory_order_relaxed);
+            epochs.retire(n, [](void* p) { delete static_cast<Node*>(p); });
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename K, typename V, typename Hash>
+size_t ConcurrentHashTable<K, V, Hash>::size() const {
+    return num_elements.load(memory_order_relaxed);
+}
+
+template<typename K, typename V, typename Hash>
+bool ConcurrentHashTable<K, V, Hash>::empty() const {
+    return size() == 0;
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::for_each(const function<void(const K&, V&)>& fn) {
+    EpochDomain::Guard guard(epochs);
+    for (auto& shard : shards) {
+        Table* t = shard.table.load(memory_order_acquire);
+        for (size_t i = 0; i <= t->mask; ++i) {
+            Node* n = t->slots[i].load(memory_order_acquire);
+            if (n && n != tombstone<Node>()) fn(n->key, n->value);
+        }
+    }
+}
+
+template<typename K, typename V, typename Hash>
+void ConcurrentHashTable<K, V, Hash>::for_each(const function<void(const K&, const V&)>& fn) const {
+    EpochDomain::Guard guard(epochs);
+    for (const auto& shard : shards) {
+        const Table* t = shard.table.load(memory_order_acquire);
+        for (size_t i = 0; i <= t->mask; ++i) {
+            const Node* n = t->slots[i].load(memory_order_acquire);
+            if (n && n != tombstone<Node>()) fn(n->key, n->value);
+        }
+    }
+}
+
+template<typename K, typename V, typename Hash>
+vector<pair<K, V>> ConcurrentHashTable<K, V, Hash>::snapshot() const {
+    vector<pair<K, V>> out;
+    out.reserve(size());
+    for_each([&](const K& key, const V& value) { out.emplace_back(key, value); });
+    return out;
+}
+
+template<typename K, typename V, typename Hash>
+EpochDomain::Guard ConcurrentHashTable<K, V, Hash>::pin() const {
+    return EpochDomain::Guard(epochs);
+}
+
+template class ConcurrentHashTable<int, Vehicle>;
+template class ConcurrentHashTable<int, Delivery>;
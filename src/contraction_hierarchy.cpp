@@ -0,0 +1,426 @@
+#include "../include/contraction_hierarchy.hpp"
+#include "../include/road_network.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+constexpr size_t SMALL_CELL = 8;
+
+struct Cell {
+    vector<int> nodes;
+    int lo;
+};
+
+}
+
+ContractionHierarchy::ContractionHierarchy(const RoadNetwork& g) : graph(g) {}
+
+void ContractionHierarchy::compute_order(const CsrGraph& g) {
+    size_t n = g.num_nodes();
+
+    vector<size_t> uoff(n + 1, 0);
+    for (size_t u = 0; u < n; ++u) {
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            if (g.targets[i] == static_cast<int>(u)) continue;
+            uoff[u + 1]++;
+            uoff[g.targets[i] + 1]++;
+        }
+    }
+    for (size_t u = 0; u < n; ++u) uoff[u + 1] += uoff[u];
+    vector<int> unb(uoff[n]);
+    vector<size_t> fill(uoff.begin(), uoff.end() - 1);
+    for (size_t u = 0; u < n; ++u) {
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            if (v == static_cast<int>(u)) continue;
+            unb[fill[u]++] = v;
+            unb[fill[v]++] = static_cast<int>(u);
+        }
+    }
+
+    rank.assign(n, -1);
+    order.assign(n, -1);
+    vector<int> cell_of(n, 0);
+    vector<int> level(n, -1);
+    vector<int> visit;
+    int next_cell = 0;
+
+    auto bfs = [&](int src, int cell) {
+        visit.clear();
+        visit.push_back(src);
+        level[src] = 0;
+        for (size_t head = 0; head < visit.size(); ++head) {
+            int u = visit[head];
+            for (size_t i = uoff[u]; i < uoff[u + 1]; ++i) {
+                int v = unb[i];
+                if (cell_of[v] != cell || level[v] >= 0) continue;
+                level[v] = level[u] + 1;
+                visit.push_back(v);
+            }
+        }
+    };
+    auto clear_levels = [&]() {
+        for (int v : visit) level[v] = -1;
+    };
+
+    vector<Cell> cells;
+    if (n > 0) {
+        cells.push_back({vector<int>(n), 0});
+        for (size_t v = 0; v < n; ++v) cells.back().nodes[v] = static_cast<int>(v);
+    }
+
+    while (!cells.empty()) {
+        Cell cell = move(cells.back());
+        cells.pop_back();
+        int id = ++next_cell;
+        for (int v : cell.nodes) cell_of[v] = id;
+
+        if (cell.nodes.size() <= SMALL_CELL) {
+            sort(cell.nodes.begin(), cell.nodes.end(), [&](int a, int b) {
+                return uoff[a + 1] - uoff[a] < uoff[b + 1] - uoff[b];
+            });
+            for (size_t i = 0; i < cell.nodes.size(); ++i) rank[cell.nodes[i]] = cell.lo + static_cast<int>(i);
+            continue;
+        }
+
+        bfs(cell.nodes[0], id);
+        if (visit.size() < cell.nodes.size()) {
+            Cell component{visit, cell.lo};
+            Cell rest{{}, cell.lo + static_cast<int>(visit.size())};
+            for (int v : cell.nodes) {
+                if (level[v] < 0) rest.nodes.push_back(v);
+            }
+            clear_levels();
+            cells.push_back(move(component));
+            cells.push_back(move(rest));
+            continue;
+        }
+
+        int far = visit.back();
+        clear_levels();
+        bfs(far, id);
+
+        int max_level = level[visit.back()];
+        int sep = level[visit[visit.size() / 2]];
+        if (sep == max_level) --sep;
+
+        Cell below{{}, cell.lo};
+        Cell above{{}, 0};
+        vector<int> separator;
+        for (int v : visit) {
+            if (level[v] < sep) {
+                below.nodes.push_back(v);
+            } else if (level[v] > sep) {
+                above.nodes.push_back(v);
+            } else {
+                bool touches_above = false;
+                for (size_t i = uoff[v]; i < uoff[v + 1] && !touches_above; ++i) {
+                    touches_above = cell_of[unb[i]] == id && level[unb[i]] == sep + 1;
+                }
+                if (touches_above) separator.push_back(v);
+                else below.nodes.push_back(v);
+            }
+        }
+        clear_levels();
+
+        above.lo = below.lo + static_cast<int>(below.nodes.size());
+        int top = above.lo + static_cast<int>(above.nodes.size());
+        for (size_t i = 0; i < separator.size(); ++i) rank[separator[i]] = top + static_cast<int>(i);
+        if (!below.nodes.empty()) cells.push_back(move(below));
+        if (!above.nodes.empty()) cells.push_back(move(above));
+    }
+
+    for (size_t v = 0; v < n; ++v) order[rank[v]] = static_cast<int>(v);
+}
+
+void ContractionHierarchy::compute_arcs(const CsrGraph& g) {
+    size_t n = g.num_nodes();
+    vector<vector<int>> up(n);
+    for (size_t u = 0; u < n; ++u) {
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int ru = rank[u], rv = rank[g.targets[i]];
+            if (ru == rv) continue;
+            up[min(ru, rv)].push_back(max(ru, rv));
+        }
+    }
+
+    etree_parent.assign(n, -1);
+    up_offsets.assign(n + 1, 0);
+    for (size_t r = 0; r < n; ++r) {
+        auto& nb = up[r];
+        sort(nb.begin(), nb.end());
+        nb.erase(unique(nb.begin(), nb.end()), nb.end());
+        up_offsets[r + 1] = up_offsets[r] + nb.size();
+        if (nb.empty()) continue;
+        int parent = nb[0];
+        etree_parent[r] = parent;
+        up[parent].insert(up[parent].end(), nb.begin() + 1, nb.end());
+    }
+
+    size_t m = up_offsets[n];
+    up_tails.resize(m);
+    up_heads.resize(m);
+    for (size_t r = 0; r < n; ++r) {
+        copy(up[r].begin(), up[r].end(), up_heads.begin() + up_offsets[r]);
+        fill(up_tails.begin() + up_offsets[r], up_tails.begin() + up_offsets[r + 1], static_cast<int>(r));
+        vector<int>().swap(up[r]);
+    }
+
+    arc_up.assign(m, INF);
+    arc_down.assign(m, INF);
+    up_mid.assign(m, -1);
+    down_mid.assign(m, -1);
+
+    edge_arc.assign(g.num_edges(), -1);
+    edge_down.assign(g.num_edges(), 0);
+    for (size_t u = 0; u < n; ++u) {
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int ru = rank[u], rv = rank[g.targets[i]];
+            if (ru == rv) continue;
+            edge_arc[i] = find_arc(min(ru, rv), max(ru, rv));
+            edge_down[i] = ru > rv;
+        }
+    }
+
+    fdist.assign(n, INF);
+    bdist.assign(n, INF);
+    fpar.assign(n, -1);
+    bpar.assign(n, -1);
+}
+
+void ContractionHierarchy::build_order() {
+    const CsrGraph& g = graph.csr();
+    compute_order(g);
+    compute_arcs(g);
+    seen_generation = g.generation;
+    built = true;
+    customize();
+}
+
+void ContractionHierarchy::customize() {
+    const CsrGraph& g = graph.csr();
+    if (!built || g.generation != seen_generation) {
+        build_order();
+        return;
+    }
+
+    fill(arc_up.begin(), arc_up.end(), INF);
+    fill(arc_down.begin(), arc_down.end(), INF);
+    fill(up_mid.begin(), up_mid.end(), -1);
+    fill(down_mid.begin(), down_mid.end(), -1);
+
+    for (size_t e = 0; e < edge_arc.size(); ++e) {
+        long a = edge_arc[e];
+        if (a < 0) continue;
+        double& slot = edge_down[e] ? arc_down[a] : arc_up[a];
+        slot = min(slot, g.weights[e]);
+    }
+
+    size_t n = rank.size();
+    for (size_t x = 0; x < n; ++x) {
+        size_t end = up_offsets[x + 1];
+        for (size_t i = up_offsets[x]; i < end; ++i) {
+            double xy_up = arc_up[i];
+            double xy_down = arc_down[i];
+            if (xy_up == INF && xy_down == INF) continue;
+
+            int y = up_heads[i];
+            size_t p = up_offsets[y];
+            for (size_t j = i + 1; j < end; ++j) {
+                int z = up_heads[j];
+                while (up_heads[p] < z) ++p;
+
+                double via = xy_down + arc_up[j];
+                if (via < arc_up[p]) {
+                    arc_up[p] = via;
+                    up_mid[p] = static_cast<int>(x);
+                }
+                via = arc_down[j] + xy_up;
+                if (via < arc_down[p]) {
+                    arc_down[p] = via;
+                    down_mid[p] = static_cast<int>(x);
+                }
+            }
+        }
+    }
+
+    seen_epoch = graph.traffic_epoch();
+}
+
+void ContractionHierarchy::prepare() {
+    const CsrGraph& g = graph.csr();
+    if (!built || g.generation != seen_generation) {
+        build_order();
+    } else if (graph.traffic_epoch() != seen_epoch) {
+        customize();
+    }
+}
+
+long ContractionHierarchy::find_arc(int lo, int hi) const {
+    auto first = up_heads.begin() + up_offsets[lo];
+    auto last = up_heads.begin() + up_offsets[lo + 1];
+    auto it = lower_bound(first, last, hi);
+    if (it == last || *it != hi) return -1;
+    return it - up_heads.begin();
+}
+
+void ContractionHierarchy::unpack(long arc, bool down, vector<int>& out) const {
+    int lo = up_tails[arc];
+    int hi = up_heads[arc];
+    int mid = down ? down_mid[arc] : up_mid[arc];
+
+    if (mid < 0) {
+        out.push_back(order[down ? lo : hi]);
+    } else if (!down) {
+        unpack(find_arc(mid, lo), true, out);
+        unpack(find_arc(mid, hi), false, out);
+    } else {
+        unpack(find_arc(mid, hi), true, out);
+        unpack(find_arc(mid, lo), false, out);
+    }
+}
+
+void ContractionHierarchy::sweep(int start, const vector<double>& w, vector<double>& dist, vector<int>& par) {
+    dist[start] = 0.0;
+    for (int x = start; x != -1; x = etree_parent[x]) {
+        if (dist[x] == INF) continue;
+        for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; ++a) {
+            double alt = dist[x] + w[a];
+            if (alt < dist[up_heads[a]]) {
+                dist[up_heads[a]] = alt;
+                par[up_heads[a]] = static_cast<int>(a);
+            }
+        }
+    }
+}
+
+void ContractionHierarchy::clear_chain(int start, vector<double>& dist, vector<int>& par) {
+    for (int x = start; x != -1; x = etree_parent[x]) {
+        dist[x] = INF;
+        par[x] = -1;
+    }
+}
+
+int ContractionHierarchy::search(int s, int t, double& best) {
+    sweep(s, arc_up, fdist, fpar);
+    sweep(t, arc_down, bdist, bpar);
+
+    best = INF;
+    int meet = -1;
+    for (int x = s; x != -1; x = etree_parent[x]) {
+        if (fdist[x] + bdist[x] < best) {
+            best = fdist[x] + bdist[x];
+            meet = x;
+        }
+    }
+    return meet;
+}
+
+void ContractionHierarchy::reset(int s, int t) {
+    clear_chain(s, fdist, fpar);
+    clear_chain(t, bdist, bpar);
+}
+
+vector<int> ContractionHierarchy::shortest_path(int start, int goal) {
+    if (start == goal) return {start};
+    prepare();
+    const CsrGraph& g = graph.csr();
+    int su = g.index_of(start);
+    int tu = g.index_of(goal);
+    if (su < 0 || tu < 0) return {};
+
+    int s = rank[su], t = rank[tu];
+    double best;
+    int meet = search(s, t, best);
+
+    vector<int> path;
+    if (meet >= 0) {
+        vector<int> arcs;
+        for (int x = meet; x != s; x = up_tails[fpar[x]]) arcs.push_back(fpar[x]);
+        reverse(arcs.begin(), arcs.end());
+
+        vector<int> dense{su};
+        for (int a : arcs) unpack(a, false, dense);
+        for (int x = meet; x != t; x = up_tails[bpar[x]]) unpack(bpar[x], true, dense);
+
+        path.reserve(dense.size());
+        for (int v : dense) path.push_back(g.id_of(v));
+    }
+
+    reset(s, t);
+    return path;
+}
+
+double ContractionHierarchy::distance(int start, int goal) {
+    if (start == goal) return 0.0;
+    prepare();
+    const CsrGraph& g = graph.csr();
+    int su = g.index_of(start);
+    int tu = g.index_of(goal);
+    if (su < 0 || tu < 0) return INF;
+
+    int s = rank[su], t = rank[tu];
+    double best;
+    search(s, t, best);
+    reset(s, t);
+    return best;
+}
+
+vector<double> ContractionHierarchy::many_to_many(const vector<int>& sources, const vector<int>& targets) {
+    prepare();
+    const CsrGraph& g = graph.csr();
+    size_t cols = targets.size();
+    vector<double> result(sources.size() * cols, INF);
+
+    struct BucketEntry {
+        int node;
+        int col;
+        double dist;
+    };
+    vector<BucketEntry> buckets;
+    for (size_t j = 0; j < cols; ++j) {
+        int tu = g.index_of(targets[j]);
+        if (tu < 0) continue;
+        int t = rank[tu];
+        sweep(t, arc_down, bdist, bpar);
+        for (int x = t; x != -1; x = etree_parent[x]) {
+            if (bdist[x] != INF) buckets.push_back({x, static_cast<int>(j), bdist[x]});
+        }
+        clear_chain(t, bdist, bpar);
+    }
+    sort(buckets.begin(), buckets.end(), [](const BucketEntry& a, const BucketEntry& b) {
+        return a.node < b.node;
+    });
+
+    for (size_t i = 0; i < sources.size(); ++i) {
+        double* row = &result[i * cols];
+        for (size_t j = 0; j < cols; ++j) {
+            if (sources[i] == targets[j]) row[j] = 0.0;
+        }
+        int su = g.index_of(sources[i]);
+        if (su < 0) continue;
+        int s = rank[su];
+        sweep(s, arc_up, fdist, fpar);
+        for (int x = s; x != -1; x = etree_parent[x]) {
+            if (fdist[x] == INF) continue;
+            auto it = lower_bound(buckets.begin(), buckets.end(), x, [](const BucketEntry& e, int node) {
+                return e.node < node;
+            });
+            for (; it != buckets.end() && it->node == x; ++it) {
+                row[it->col] = min(row[it->col], fdist[x] + it->dist);
+            }
+        }
+        clear_chain(s, fdist, fpar);
+    }
+    return result;
+}
+
+size_t ContractionHierarchy::num_arcs() const {
+    return up_heads.size();
+}
+
+int ContractionHierarchy::rank_of(int idx) const {
+    return rank[idx];
+}
@@ -0,0 +1,107 @@
+#include "../include/csr_graph.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void CsrGraph::build(const unordered_map<int, vector<Edge>>& adj,
+                     const unordered_map<int, pair<double, double>>& positions) {
+    unsigned long next_generation = generation + 1;
+    clear();
+    generation = next_generation;
+
+    for (const auto& [u, edges] : adj) {
+        node_ids.push_back(u);
+        for (const auto& e : edges) node_ids.push_back(e.to);
+    }
+    sort(node_ids.begin(), node_ids.end());
+    node_ids.erase(unique(node_ids.begin(), node_ids.end()), node_ids.end());
+
+    size_t n = node_ids.size();
+    node_index.reserve(n);
+    for (size_t i = 0; i < n; ++i) node_index[node_ids[i]] = static_cast<int>(i);
+
+    offsets.assign(n + 1, 0);
+    for (const auto& [u, edges] : adj) {
+        offsets[node_index[u] + 1] = edges.size();
+    }
+    for (size_t i = 0; i < n; ++i) offsets[i + 1] += offsets[i];
+
+    size_t m = offsets[n];
+    targets.resize(m);
+    weights.resize(m);
+    base_weights.resize(m);
+    for (const auto& [u, edges] : adj) {
+        size_t slot = offsets[node_index[u]];
+        for (const auto& e : edges) {
+            targets[slot] = node_index[e.to];
+            weights[slot] = e.weight;
+            base_weights[slot] = e.base_weight;
+            ++slot;
+        }
+    }
+
+    rev_offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < m; ++i) rev_offsets[targets[i] + 1]++;
+    for (size_t i = 0; i < n; ++i) rev_offsets[i + 1] += rev_offsets[i];
+    rev_sources.resize(m);
+    rev_slots.resize(m);
+    vector<size_t> fill(rev_offsets.begin(), rev_offsets.end() - 1);
+    for (size_t u = 0; u < n; ++u) {
+        for (size_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+            size_t r = fill[targets[i]]++;
+            rev_sources[r] = static_cast<int>(u);
+            rev_slots[r] = i;
+        }
+    }
+
+    xs.assign(n, numeric_limits<double>::quiet_NaN());
+    ys.assign(n, numeric_limits<double>::quiet_NaN());
+    for (const auto& [id, pos] : positions) {
+        auto it = node_index.find(id);
+        if (it == node_index.end()) continue;
+        xs[it->second] = pos.first;
+        ys[it->second] = pos.second;
+    }
+}
+
+void CsrGraph::clear() {
+    node_ids.clear();
+    node_index.clear();
+    offsets.assign(1, 0);
+    targets.clear();
+    weights.clear();
+    base_weights.clear();
+    rev_offsets.assign(1, 0);
+    rev_sources.clear();
+    rev_slots.clear();
+    xs.clear();
+    ys.clear();
+}
+
+size_t CsrGraph::num_nodes() const {
+    return node_ids.size();
+}
+
+size_t CsrGraph::num_edges() const {
+    return targets.size();
+}
+
+int CsrGraph::index_of(int id) const {
+    auto it = node_index.find(id);
+    return it == node_index.end() ? -1 : it->second;
+}
+
+int CsrGraph::id_of(int idx) const {
+    return node_ids[idx];
+}
+
+long CsrGraph::find_edge(int u, int v) const {
+    for (size_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+        if (targets[i] == v) return static_cast<long>(i);
+    }
+    return -1;
+}
+
+bool CsrGraph::has_position(int idx) const {
+    return !isnan(xs[idx]) && !isnan(ys[idx]);
+}
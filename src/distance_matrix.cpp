@@ -0,0 +1,134 @@
+#include "../include/distance_matrix.hpp"
+#include "../include/contraction_hierarchy.hpp"
+#include <limits>
+
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+
+// One-to-many Dijkstra from each source on the CSR arrays, stopping as soon
+// as every requested target has been settled.
+template<typename Frontier>
+void one_to_many(const CsrGraph& g, DistanceMatrix& m, bool with_paths) {
+    size_t n = g.num_nodes();
+    size_t cols = m.targets.size();
+    vector<double> dist(n, INF);
+    vector<int> prev(n, -1);
+    Frontier pq(n);
+    vector<int> touched;
+    vector<char> wanted(n, 0);
+    vector<int> target_idx(cols, -1);
+    size_t distinct = 0;
+
+    for (size_t j = 0; j < cols; ++j) {
+        target_idx[j] = g.index_of(m.targets[j]);
+        if (target_idx[j] >= 0 && !wanted[target_idx[j]]) {
+            wanted[target_idx[j]] = 1;
+            ++distinct;
+        }
+    }
+
+    for (size_t i = 0; i < m.sources.size(); ++i) {
+        int s = g.index_of(m.sources[i]);
+        if (s >= 0) {
+            size_t remaining = distinct;
+            dist[s] = 0.0;
+            touched.push_back(s);
+            pq.push(s, 0.0);
+
+            while (!pq.empty() && remaining > 0) {
+                auto [cost, u] = pq.pop();
+                if (cost > dist[u]) continue;
+                if (wanted[u]) --remaining;
+
+                for (size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+                    int v = g.targets[k];
+                    double alt = cost + g.weights[k];
+                    if (alt < dist[v]) {
+                        if (dist[v] == INF) touched.push_back(v);
+                        dist[v] = alt;
+                        prev[v] = u;
+                        pq.push(v, alt);
+                    }
+                }
+            }
+            pq.clear();
+        }
+
+        for (size_t j = 0; j < cols; ++j) {
+            size_t cell = i * cols + j;
+            if (m.sources[i] == m.targets[j]) {
+                m.costs[cell] = 0.0;
+                if (with_paths) m.paths[cell] = {m.sources[i]};
+                continue;
+            }
+            int t = target_idx[j];
+            if (s < 0 || t < 0 || dist[t] == INF) continue;
+            m.costs[cell] = dist[t];
+            if (with_paths) {
+                auto& path = m.paths[cell];
+                for (int at = t; at != -1; at = prev[at]) path.push_back(g.id_of(at));
+                reverse(path.begin(), path.end());
+            }
+        }
+
+        for (int v : touched) {
+            dist[v] = INF;
+            prev[v] = -1;
+        }
+        touched.clear();
+    }
+}
+
+}
+
+double DistanceMatrix::cost(size_t row, size_t col) const {
+    return costs[row * targets.size() + col];
+}
+
+double DistanceMatrix::between(int from, int to) const {
+    auto r = row_of.find(from);
+    auto c = col_of.find(to);
+    if (r == row_of.end() || c == col_of.end()) return INF;
+    return cost(r->second, c->second);
+}
+
+const vector<int>& DistanceMatrix::path(size_t row, size_t col) const {
+    return paths[row * targets.size() + col];
+}
+
+bool DistanceMatrix::has_paths() const {
+    return !paths.empty();
+}
+
+template<typename Frontier>
+DistanceMatrix many_to_many(const RoadNetwork& graph, const vector<int>& sources,
+                            const vector<int>& targets, bool with_paths) {
+    DistanceMatrix m;
+    m.sources = sources;
+    m.targets = targets;
+    for (size_t i = 0; i < sources.size(); ++i) m.row_of.emplace(sources[i], i);
+    for (size_t j = 0; j < targets.size(); ++j) m.col_of.emplace(targets[j], j);
+    m.costs.assign(sources.size() * targets.size(), INF);
+    if (with_paths) m.paths.assign(m.costs.size(), {});
+    if (sources.empty() || targets.empty()) return m;
+
+    if (graph.routing_mode() == RoutingMode::ContractionHierarchy) {
+        m.costs = graph.hierarchy().many_to_many(sources, targets);
+        if (with_paths) {
+            for (size_t i = 0; i < sources.size(); ++i) {
+                for (size_t j = 0; j < targets.size(); ++j) {
+                    if (m.costs[i * targets.size() + j] == INF) continue;
+                    m.paths[i * targets.size() + j] = graph.hierarchy().shortest_path(sources[i], targets[j]);
+                }
+            }
+        }
+        return m;
+    }
+
+    one_to_many<Frontier>(graph.csr(), m, with_paths);
+    return m;
+}
+
+template DistanceMatrix many_to_many<HeapFrontier>(const RoadNetwork&, const vector<int>&, const vector<int>&, bool);
+template DistanceMatrix many_to_many<RadixFrontier>(const RoadNetwork&, const vector<int>&, const vector<int>&, bool);
@@ -0,0 +1,202 @@
+#include "../include/dynamic_sssp.hpp"
+#include "../include/road_network.hpp"
+#include <limits>
+
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+
+struct SlotChange {
+    long slot;
+    int from;
+    double old_weight;
+};
+
+}
+
+DynamicSSSP::DynamicSSSP(const RoadNetwork& g) : graph(g) {}
+
+void DynamicSSSP::add_hub(int id) {
+    if (hub_index.count(id)) return;
+    hub_index[id] = hub_ids.size();
+    hub_ids.push_back(id);
+    trees.push_back({-1, {}, {}, {}});
+    built = false;
+}
+
+bool DynamicSSSP::is_hub(int id) const {
+    return hub_index.count(id) > 0;
+}
+
+const vector<int>& DynamicSSSP::hubs() const {
+    return hub_ids;
+}
+
+size_t DynamicSSSP::last_repaired() const {
+    return repaired;
+}
+
+void DynamicSSSP::sync() {
+    const CsrGraph& g = graph.csr();
+    if (!built || g.generation != seen_generation) {
+        rebuild(g);
+        return;
+    }
+    if (graph.traffic_epoch() == seen_epoch) return;
+
+    vector<EdgeChange> changes;
+    if (!graph.changes_since(seen_epoch, changes)) {
+        rebuild(g);
+        return;
+    }
+
+    repaired = 0;
+    for (auto& tree : trees) repair(g, tree, changes);
+    seen_epoch = graph.traffic_epoch();
+}
+
+void DynamicSSSP::rebuild(const CsrGraph& g) {
+    affected.assign(g.num_nodes(), 0);
+    repaired = 0;
+    for (size_t h = 0; h < trees.size(); ++h) {
+        trees[h].root = g.index_of(hub_ids[h]);
+        grow(g, trees[h]);
+    }
+    seen_generation = g.generation;
+    seen_epoch = graph.traffic_epoch();
+    built = true;
+}
+
+void DynamicSSSP::grow(const CsrGraph& g, Tree& tree) {
+    size_t n = g.num_nodes();
+    tree.dist.assign(n, INF);
+    tree.parent.assign(n, -1);
+    tree.parent_slot.assign(n, -1);
+    if (tree.root < 0) return;
+
+    tree.dist[tree.root] = 0.0;
+    vector<int> seeds{tree.root};
+    settle(g, tree, seeds);
+}
+
+void DynamicSSSP::settle(const CsrGraph& g, Tree& tree, vector<int>& seeds) {
+    using P = pair<double, int>;
+    priority_queue<P, vector<P>, greater<P>> pq;
+    for (int x : seeds) pq.push({tree.dist[x], x});
+
+    while (!pq.empty()) {
+        auto [cost, u] = pq.top();
+        pq.pop();
+        if (cost > tree.dist[u]) continue;
+        ++repaired;
+
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            double alt = cost + g.weights[i];
+            if (alt < tree.dist[v]) {
+                tree.dist[v] = alt;
+                tree.parent[v] = u;
+                tree.parent_slot[v] = static_cast<long>(i);
+                pq.push({alt, v});
+            }
+        }
+    }
+}
+
+void DynamicSSSP::repair(const CsrGraph& g, Tree& tree, const vector<EdgeChange>& changes) {
+    if (tree.root < 0) return;
+
+    vector<SlotChange> slots;
+    unordered_map<long, size_t> seen;
+    for (const auto& c : changes) {
+        int u = g.index_of(c.from);
+        int v = g.index_of(c.to);
+        if (u < 0 || v < 0) continue;
+        long slot = g.find_edge(u, v);
+        if (slot < 0 || seen.count(slot)) continue;
+        seen[slot] = slots.size();
+        slots.push_back({slot, u, c.old_weight});
+    }
+
+    vector<int> region;
+    for (const auto& sc : slots) {
+        int v = g.targets[sc.slot];
+        if (g.weights[sc.slot] > sc.old_weight && tree.parent_slot[v] == sc.slot && !affected[v]) {
+            affected[v] = 1;
+            region.push_back(v);
+        }
+    }
+    for (size_t head = 0; head < region.size(); ++head) {
+        int x = region[head];
+        for (size_t i = g.offsets[x]; i < g.offsets[x + 1]; ++i) {
+            int y = g.targets[i];
+            if (!affected[y] && tree.parent_slot[y] == static_cast<long>(i)) {
+                affected[y] = 1;
+                region.push_back(y);
+            }
+        }
+    }
+
+    for (int x : region) {
+        tree.dist[x] = INF;
+        tree.parent[x] = -1;
+        tree.parent_slot[x] = -1;
+    }
+
+    vector<int> seeds;
+    for (int x : region) {
+        for (size_t r = g.rev_offsets[x]; r < g.rev_offsets[x + 1]; ++r) {
+            int y = g.rev_sources[r];
+            if (affected[y] || tree.dist[y] == INF) continue;
+            double alt = tree.dist[y] + g.weights[g.rev_slots[r]];
+            if (alt < tree.dist[x]) {
+                tree.dist[x] = alt;
+                tree.parent[x] = y;
+                tree.parent_slot[x] = static_cast<long>(g.rev_slots[r]);
+            }
+        }
+        if (tree.dist[x] != INF) seeds.push_back(x);
+    }
+    for (int x : region) affected[x] = 0;
+
+    for (const auto& sc : slots) {
+        if (g.weights[sc.slot] >= sc.old_weight || tree.dist[sc.from] == INF) continue;
+        int v = g.targets[sc.slot];
+        double alt = tree.dist[sc.from] + g.weights[sc.slot];
+        if (alt < tree.dist[v]) {
+            tree.dist[v] = alt;
+            tree.parent[v] = sc.from;
+            tree.parent_slot[v] = sc.slot;
+            seeds.push_back(v);
+        }
+    }
+
+    settle(g, tree, seeds);
+}
+
+double DynamicSSSP::distance(int hub, int target) {
+    if (hub == target) return 0.0;
+    auto it = hub_index.find(hub);
+    if (it == hub_index.end()) return INF;
+    sync();
+    const CsrGraph& g = graph.csr();
+    int t = g.index_of(target);
+    if (t < 0) return INF;
+    return trees[it->second].dist[t];
+}
+
+vector<int> DynamicSSSP::path(int hub, int target) {
+    if (hub == target) return {hub};
+    auto it = hub_index.find(hub);
+    if (it == hub_index.end()) return {};
+    sync();
+    const CsrGraph& g = graph.csr();
+    const Tree& tree = trees[it->second];
+    int t = g.index_of(target);
+    if (t < 0 || tree.dist[t] == INF) return {};
+
+    vector<int> result;
+    for (int at = t; at != -1; at = tree.parent[at]) result.push_back(g.id_of(at));
+    reverse(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,117 @@
+#include "../include/epoch_reclaim.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Per-thread pin state. A thread owns one record per domain it has pinned;
+// the common case is the single global domain, so a short list is enough.
+struct ThreadPins {
+    struct Pin {
+        EpochDomain* domain;
+        size_t slot;
+        size_t depth;
+    };
+    vector<Pin> pins;
+    void (*release)(EpochDomain*, size_t) = nullptr;
+
+    Pin& of(EpochDomain* d) {
+        for (auto& p : pins) {
+            if (p.domain == d) return p;
+        }
+        pins.push_back({d, numeric_limits<size_t>::max(), 0});
+        return pins.back();
+    }
+
+    ~ThreadPins() {
+        for (auto& p : pins) {
+            if (release && p.slot != numeric_limits<size_t>::max()) release(p.domain, p.slot);
+        }
+    }
+};
+
+thread_local ThreadPins thread_pins;
+
+}
+
+EpochDomain::Guard::Guard(EpochDomain& d) : domain(&d) {
+    domain->enter();
+}
+
+EpochDomain::Guard::~Guard() {
+    domain->leave();
+}
+
+EpochDomain::~EpochDomain() {
+    for (auto& r : retired) r.deleter(r.ptr);
+}
+
+size_t EpochDomain::claim_record() {
+    for (size_t i = 0; i < MAX_THREADS; ++i) {
+        bool expected = false;
+        if (!records[i].owned.load(memory_order_relaxed) &&
+            records[i].owned.compare_exchange_strong(expected, true)) {
+            return i;
+        }
+    }
+    throw runtime_error("EpochDomain: too many concurrent threads");
+}
+
+void EpochDomain::release_record(size_t slot) {
+    records[slot].epoch.store(0);
+    records[slot].owned.store(false);
+}
+
+void EpochDomain::enter() {
+    auto& pin = thread_pins.of(this);
+    if (pin.depth++ > 0) return;
+    if (pin.slot == numeric_limits<size_t>::max()) {
+        pin.slot = claim_record();
+        thread_pins.release = [](EpochDomain* d, size_t slot) { d->release_record(slot); };
+    }
+    records[pin.slot].epoch.store(global_epoch.load());
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void EpochDomain::leave() {
+    auto& pin = thread_pins.of(this);
+    if (--pin.depth > 0) return;
+    records[pin.slot].epoch.store(0);
+}
+
+void EpochDomain::retire(void* ptr, void (*deleter)(void*)) {
+    lock_guard<mutex> lock(retired_mtx);
+    retired.push_back({ptr, deleter, global_epoch.fetch_add(1)});
+    if (retired.size() >= RECLAIM_BATCH) reclaim();
+}
+
+size_t EpochDomain::pending() const {
+    lock_guard<mutex> lock(retired_mtx);
+    return retired.size();
+}
+
+void EpochDomain::reclaim() {
+    // Readers pinned at epoch e may hold anything retired at epoch >= e.
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t oldest = numeric_limits<uint64_t>::max();
+    for (const auto& r : records) {
+        uint64_t e = r.epoch.load();
+        if (e != 0) oldest = min(oldest, e);
+    }
+
+    size_t kept = 0;
+    for (auto& r : retired) {
+        if (r.epoch < oldest) {
+            r.deleter(r.ptr);
+        } else {
+            retired[kept++] = r;
+        }
+    }
+    retired.resize(kept);
+}
+
+EpochDomain& EpochDomain::global() {
+    static EpochDomain domain;
+    return domain;
+}
@@ -1,19 +1,23 @@
 #include "../include/file_io.hpp"
-#include <fstream>
-#include <sstream>
-#include <iostream>
-#include <chrono>
-#include <iomanip>
+#include "../include/text_scanner.hpp"
+#include <string_view>
+
+// Loaders map the whole file and parse it in place: no per-line string or
+// stream is built, and containers are sized from a newline count up front.
+// Lines that do not parse are skipped.
 
 bool load_city_map(const string& filename, RoadNetwork& graph) {
-    ifstream file(filename);
-    if (!file) return false;
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    // Road graphs average more than two out-edges per node.
+    graph.reserve(count_lines(file.text()) / 2);
+    LineReader lines(file.text());
+    string_view line;
+    while (lines.next(line)) {
+        FieldReader in(line);
         int from, to;
         double weight;
-        if (iss >> from >> to >> weight) {
+        if (in.read(from) && in.read(to) && in.read(weight)) {
             graph.add_edge(from, to, weight);
         }
     }
@@ -21,16 +25,20 @@ bool load_city_map(const string& filename, RoadNetwork& graph) {
 }
 
 bool load_locations(const string& filename, HashTable<int, Location>& loc_db, vector<Location*>& all_locs) {
-    ifstream file(filename);
-    if (!file) return false;
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    size_t expected = count_lines(file.text());
+    loc_db.reserve(loc_db.size() + expected);
+    all_locs.reserve(all_locs.size() + expected);
+    LineReader lines(file.text());
+    string_view line;
+    while (lines.next(line)) {
+        FieldReader in(line);
         int id;
-        string name, type;
+        string_view name, type;
         double x, y;
-        if (iss >> id >> name >> x >> y >> type) {
-            Location loc = {id, name, x, y, type};
+        if (in.read(id) && in.read(name) && in.read(x) && in.read(y) && in.read(type)) {
+            Location loc = {id, string(name), x, y, string(type)};
             loc_db.insert(id, loc);
             auto opt = loc_db.find(id);
             if (opt) {
@@ -42,14 +50,18 @@ bool load_locations(const string& filename, HashTable<int, Location>& loc_db, ve
 }
 
 bool load_vehicles(const string& filename, HashTable<int, Vehicle>& vehicle_db, HashTable<int, Location>& loc_db, vector<int>& vehicle_ids) {
-    ifstream file(filename);
-    if (!file) return false;
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    size_t expected = count_lines(file.text());
+    vehicle_db.reserve(vehicle_db.size() + expected);
+    vehicle_ids.reserve(vehicle_ids.size() + expected);
+    LineReader lines(file.text());
+    string_view line;
+    while (lines.next(line)) {
+        FieldReader in(line);
         int id, start_loc;
         double capacity, speed;
-        if (iss >> id >> capacity >> speed >> start_loc) {
+        if (in.read(id) && in.read(capacity) && in.read(speed) && in.read(start_loc)) {
             auto loc_opt = loc_db.find(start_loc);
             if (loc_opt) {
                 Vehicle v = {id, capacity, speed, **loc_opt};
@@ -62,19 +74,21 @@ bool load_vehicles(const string& filename, HashTable<int, Vehicle>& vehicle_db,
 }
 
 bool load_deliveries(const string& filename, vector<Delivery>& deliveries, HashTable<int, Delivery>& delivery_db) {
-    ifstream file(filename);
-    if (!file) return false;
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    size_t expected = count_lines(file.text());
+    deliveries.reserve(deliveries.size() + expected);
+    delivery_db.reserve(delivery_db.size() + expected);
+    LineReader lines(file.text());
+    string_view line;
+    while (lines.next(line)) {
+        FieldReader in(line);
         int id, source, dest, priority;
         double weight;
-        string deadline_str;
-        if (iss >> id >> source >> dest >> deadline_str >> priority >> weight) {
-            tm tm{};
-            istringstream ss(deadline_str);
-            ss >> get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-            auto tp = chrono::system_clock::from_time_t(mktime(&tm));
+        string_view deadline_str;
+        TimePoint tp;
+        if (in.read(id) && in.read(source) && in.read(dest) && in.read(deadline_str) &&
+            parse_iso8601(deadline_str, tp) && in.read(priority) && in.read(weight)) {
             Delivery d = {id, source, dest, tp, priority, weight};
             deliveries.push_back(d);
             delivery_db.insert(id, d);
@@ -84,17 +98,22 @@ bool load_deliveries(const string& filename, vector<Delivery>& deliveries, HashT
 }
 
 bool load_traffic_updates(const string& filename, RoadNetwork& graph) {
-    ifstream file(filename);
-    if (!file) return false;
-    string line;
-    while (getline(file, line)) {
-        istringstream iss(line);
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    LineReader lines(file.text());
+    string_view line;
+    while (lines.next(line)) {
+        FieldReader in(line);
         int from, to;
         double new_weight;
-        string timestamp;
-        if (iss >> from >> to >> new_weight >> timestamp) {
+        string_view timestamp;
+        if (in.read(from) && in.read(to) && in.read(new_weight) && in.read(timestamp)) {
             graph.update_edge_weight(from, to, new_weight);
+            TimePoint at;
+            if (parse_iso8601(timestamp, at)) {
+                graph.add_traffic_sample(from, to, at, new_weight);
+            }
         }
     }
     return true;
-}
\ No newline at end of file
+}
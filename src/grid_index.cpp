@@ -0,0 +1,238 @@
+#include "../include/grid_index.hpp"
+#include "../include/spatial_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+bool closer(const pair<double, VehicleIndex::Item>& a, const pair<double, VehicleIndex::Item>& b) {
+    return a.first < b.first;
+}
+
+}
+
+GridIndex::GridIndex(double size) : cell_size(size) {
+    if (!(cell_size > 0.0)) throw invalid_argument("GridIndex cell size must be positive");
+}
+
+int32_t GridIndex::coord(double v) const {
+    return static_cast<int32_t>(floor(v / cell_size));
+}
+
+int64_t GridIndex::key(int32_t cx, int32_t cy) {
+    return static_cast<int64_t>(static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32 | static_cast<uint32_t>(cy));
+}
+
+void GridIndex::add(Location* loc, Vehicle* veh) {
+    int32_t cx = coord(veh->current_x);
+    int32_t cy = coord(veh->current_y);
+    if (max_cx < min_cx) {
+        min_cx = max_cx = cx;
+        min_cy = max_cy = cy;
+    } else {
+        min_cx = min(min_cx, cx);
+        max_cx = max(max_cx, cx);
+        min_cy = min(min_cy, cy);
+        max_cy = max(max_cy, cy);
+    }
+
+    int64_t k = key(cx, cy);
+    Cell& cell = cells[k];
+    slot_of[veh->id] = {k, cell.items.size()};
+    cell.items.emplace_back(loc, veh);
+    cell.xs.push_back(veh->current_x);
+    cell.ys.push_back(veh->current_y);
+}
+
+void GridIndex::erase(const Slot& slot) {
+    auto it = cells.find(slot.cell);
+    Cell& cell = it->second;
+    size_t last = cell.items.size() - 1;
+    if (slot.index != last) {
+        cell.items[slot.index] = cell.items[last];
+        cell.xs[slot.index] = cell.xs[last];
+        cell.ys[slot.index] = cell.ys[last];
+        slot_of[cell.items[slot.index].second->id].index = slot.index;
+    }
+    cell.items.pop_back();
+    cell.xs.pop_back();
+    cell.ys.pop_back();
+    if (cell.items.empty()) cells.erase(it);
+    if (cells.empty()) {
+        min_cx = min_cy = 0;
+        max_cx = max_cy = -1;
+    }
+}
+
+void GridIndex::insert_vehicle(Vehicle* veh) {
+    if (!veh) return;
+    remove_vehicle(veh->id);
+    add(&veh->current_pos, veh);
+}
+
+void GridIndex::update_vehicle_position(int veh_id, double new_x, double new_y) {
+    auto it = slot_of.find(veh_id);
+    if (it == slot_of.end()) return;
+    Slot slot = it->second;
+    Cell& cell = cells.at(slot.cell);
+    Item item = cell.items[slot.index];
+    item.second->current_x = new_x;
+    item.second->current_y = new_y;
+
+    if (key(coord(new_x), coord(new_y)) == slot.cell) {
+        cell.xs[slot.index] = new_x;
+        cell.ys[slot.index] = new_y;
+        return;
+    }
+    erase(slot);
+    add(item.first, item.second);
+}
+
+bool GridIndex::remove_vehicle(int veh_id) {
+    auto it = slot_of.find(veh_id);
+    if (it == slot_of.end()) return false;
+    Slot slot = it->second;
+    slot_of.erase(it);
+    erase(slot);
+    return true;
+}
+
+vector<VehicleIndex::Item> GridIndex::query_radius(double x, double y, double radius) const {
+    vector<Item> result;
+    vector<uint32_t> hits;
+    int32_t lo_x = max(coord(x - radius), min_cx), hi_x = min(coord(x + radius), max_cx);
+    int32_t lo_y = max(coord(y - radius), min_cy), hi_y = min(coord(y + radius), max_cy);
+
+    for (int32_t cx = lo_x; cx <= hi_x; ++cx) {
+        for (int32_t cy = lo_y; cy <= hi_y; ++cy) {
+            auto it = cells.find(key(cx, cy));
+            if (it == cells.end()) continue;
+            const Cell& cell = it->second;
+            if (hits.size() < cell.items.size()) hits.resize(cell.items.size());
+            size_t found = within_kernel(cell.xs.data(), cell.ys.data(), cell.items.size(),
+                                         x, y, radius*radius, hits.data());
+            for (size_t i = 0; i < found; ++i) result.push_back(cell.items[hits[i]]);
+        }
+    }
+    return result;
+}
+
+void GridIndex::scan_cell(const Cell& cell, double x, double y, size_t k, const ItemFilter& filter,
+                          vector<pair<double, Item>>& best, vector<double>& dist) const {
+    size_t n = cell.items.size();
+    if (dist.size() < n) dist.resize(n);
+    dist2_kernel(cell.xs.data(), cell.ys.data(), n, x, y, dist.data());
+
+    for (size_t i = 0; i < n; ++i) {
+        if (best.size() == k && dist[i] >= best.front().first) continue;
+        const Item& item = cell.items[i];
+        if (filter && !filter(item.first, item.second)) continue;
+        if (best.size() == k) {
+            pop_heap(best.begin(), best.end(), closer);
+            best.pop_back();
+        }
+        best.push_back({dist[i], item});
+        push_heap(best.begin(), best.end(), closer);
+    }
+}
+
+vector<VehicleIndex::Item> GridIndex::k_nearest(double x, double y, size_t k, const ItemFilter& filter) const {
+    vector<pair<double, Item>> best;
+    vector<double> dist;
+    nearest(x, y, k, filter, best, dist);
+    vector<Item> result;
+    result.reserve(best.size());
+    for (auto& [d, item] : best) result.push_back(item);
+    return result;
+}
+
+void GridIndex::k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k, const BatchFilter& filter,
+                                vector<size_t>& offsets, vector<Item>& out) const {
+    offsets.resize(m + 1);
+    out.clear();
+    vector<pair<double, Item>> best;
+    vector<double> dist;
+    for (size_t i = 0; i < m; ++i) {
+        offsets[i] = out.size();
+        ItemFilter one;
+        if (filter) one = [&filter, i](const Location* loc, const Vehicle* veh) { return filter(i, loc, veh); };
+        nearest(qx[i], qy[i], k, one, best, dist);
+        for (auto& [d, item] : best) out.push_back(item);
+    }
+    offsets[m] = out.size();
+}
+
+// Leaves the k best in `best`, nearest first.
+void GridIndex::nearest(double x, double y, size_t k, const ItemFilter& filter,
+                        vector<pair<double, Item>>& best, vector<double>& dist) const {
+    best.clear();
+    if (k == 0 || cells.empty()) return;
+
+    // Clamp the start cell into the occupied range. The ring bound below is
+    // measured from the query point itself, so this stays exact; it just
+    // never fires early when the query lies outside the scanned square.
+    int32_t qx = min(max(coord(x), min_cx), max_cx);
+    int32_t qy = min(max(coord(y), min_cy), max_cy);
+    int32_t max_ring = max({qx - min_cx, max_cx - qx, qy - min_cy, max_cy - qy});
+
+    auto visit = [&](int32_t cx, int32_t cy) {
+        auto it = cells.find(key(cx, cy));
+        if (it != cells.end()) scan_cell(it->second, x, y, k, filter, best, dist);
+    };
+    int32_t r = 0;
+    bool sparse = false;
+    for (; r <= max_ring; ++r) {
+        if (best.size() == k) {
+            // Rings 0..r-1 cover a square; anything outside it is at least
+            // the distance from the query to the square's nearest side.
+            double gap = min({x - (qx - r + 1) * cell_size, (qx + r) * cell_size - x,
+                              y - (qy - r + 1) * cell_size, (qy + r) * cell_size - y});
+            gap = max(gap, 0.0);
+            if (best.front().first <= gap * gap) break;
+        }
+        // Once a ring has more cells than are occupied (a sparse fleet, or a
+        // filter that rejects most items), finish over the occupied cells.
+        if (static_cast<size_t>(r) * 8 > cells.size()) {
+            sparse = true;
+            break;
+        }
+        if (r == 0) {
+            visit(qx, qy);
+            continue;
+        }
+        for (int32_t cx = qx - r; cx <= qx + r; ++cx) {
+            visit(cx, qy - r);
+            visit(cx, qy + r);
+        }
+        for (int32_t cy = qy - r + 1; cy <= qy + r - 1; ++cy) {
+            visit(qx - r, cy);
+            visit(qx + r, cy);
+        }
+    }
+
+    if (sparse) {
+        for (const auto& [id, cell] : cells) {
+            int32_t cx = static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint64_t>(id) >> 32));
+            int32_t cy = static_cast<int32_t>(static_cast<uint32_t>(id));
+            if (max(abs(cx - qx), abs(cy - qy)) < r) continue;
+            // Skip cells whose nearest point is no closer than the k-th best.
+            if (best.size() == k) {
+                double dx = max({cx * cell_size - x, x - (cx + 1) * cell_size, 0.0});
+                double dy = max({cy * cell_size - y, y - (cy + 1) * cell_size, 0.0});
+                if (best.front().first <= dx * dx + dy * dy) continue;
+            }
+            scan_cell(cell, x, y, k, filter, best, dist);
+        }
+    }
+
+    sort_heap(best.begin(), best.end(), closer);
+}
+
+VehicleIndex::Item GridIndex::find_nearest_vehicle(double x, double y) const {
+    auto found = k_nearest(x, y, 1, [](const Location*, const Vehicle* veh) {
+        return veh && veh->available;
+    });
+    if (found.empty()) return {nullptr, nullptr};
+    return found[0];
+}
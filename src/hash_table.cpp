@@ -1,90 +1,250 @@
 #include "../include/hash_table.hpp"
 #include <utility>
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-template<typename K, typename V>
-HashTable<K, V>::HashTable() : table(DEFAULT_SIZE), hash_func([](const K& k){ return hash<K>{}(k); }) {}
-
-template<typename K, typename V>
-HashTable<K, V>::HashTable(size_t initial_size, function<size_t(const K&)> hasher)
-    : table(initial_size), hash_func(hasher) {}
-
-template<typename K, typename V>
-void HashTable<K, V>::insert(const K& key, V value) {
-    size_t idx = get_index(key);
-    auto& chain = table[idx];
-    for (auto& p : chain) {
-        if (p.first == key) {
-            p.second = move(value);
-            return;
+namespace {
+
+constexpr int8_t EMPTY = -128;
+constexpr int8_t DELETED = -2;
+
+inline size_t h1(size_t h) { return h >> 7; }
+inline int8_t h2(size_t h) { return static_cast<int8_t>(h & 0x7F); }
+
+inline int lowest_bit(uint32_t mask) { return __builtin_ctz(mask); }
+
+#ifdef __SSE2__
+inline uint32_t match_byte(const int8_t* group, int8_t tag) {
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+}
+
+inline uint32_t match_free(const int8_t* group) {
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+}
+#else
+inline uint32_t match_byte(const int8_t* group, int8_t tag) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; ++i) {
+        if (group[i] == tag) mask |= 1u << i;
+    }
+    return mask;
+}
+
+inline uint32_t match_free(const int8_t* group) {
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; ++i) {
+        if (group[i] < 0) mask |= 1u << i;
+    }
+    return mask;
+}
+#endif
+
+size_t capacity_for(size_t elements, size_t group_width) {
+    size_t cap = group_width;
+    while (cap * 7 / 8 < elements) cap *= 2;
+    return cap;
+}
+
+}
+
+template<typename K, typename V, typename Hash>
+HashTable<K, V, Hash>::HashTable() : HashTable(DEFAULT_SIZE) {}
+
+template<typename K, typename V, typename Hash>
+HashTable<K, V, Hash>::HashTable(size_t initial_size, Hash hasher)
+    : ctrl(capacity_for(initial_size, GROUP_WIDTH), EMPTY),
+      slots(ctrl.size()),
+      hash_func(move(hasher)) {}
+
+template<typename K, typename V, typename Hash>
+size_t HashTable<K, V, Hash>::hash_of(const K& key) const {
+    uint64_t h = static_cast<uint64_t>(hash_func(key));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+template<typename K, typename V, typename Hash>
+long HashTable<K, V, Hash>::find_slot(const K& key, size_t h) const {
+    size_t group_mask = ctrl.size() / GROUP_WIDTH - 1;
+    size_t g = h1(h) & group_mask;
+    int8_t tag = h2(h);
+
+    for (size_t step = 1; step <= group_mask + 1; ++step) {
+        const int8_t* group = ctrl.data() + g * GROUP_WIDTH;
+        for (uint32_t m = match_byte(group, tag); m; m &= m - 1) {
+            size_t idx = g * GROUP_WIDTH + lowest_bit(m);
+            if (nodes[slots[idx]].key == key) return static_cast<long>(idx);
         }
+        if (match_byte(group, EMPTY)) return -1;
+        g = (g + step) & group_mask;
+    }
+    return -1;
+}
+
+template<typename K, typename V, typename Hash>
+size_t HashTable<K, V, Hash>::find_insert_slot(size_t h) const {
+    size_t group_mask = ctrl.size() / GROUP_WIDTH - 1;
+    size_t g = h1(h) & group_mask;
+
+    for (size_t step = 1;; ++step) {
+        uint32_t m = match_free(ctrl.data() + g * GROUP_WIDTH);
+        if (m) return g * GROUP_WIDTH + lowest_bit(m);
+        g = (g + step) & group_mask;
+    }
+}
+
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::insert(const K& key, V value) {
+    size_t h = hash_of(key);
+    long found = find_slot(key, h);
+    if (found >= 0) {
+        nodes[slots[found]].value = move(value);
+        return;
+    }
+
+    if ((num_elements + tombstones + 1) > ctrl.size() * 7 / 8) {
+        rehash(capacity_for(num_elements + 1, GROUP_WIDTH));
     }
-    chain.emplace_back(key, move(value));
+
+    size_t node;
+    if (!free_nodes.empty()) {
+        node = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[node].key = key;
+        nodes[node].value = move(value);
+        nodes[node].live = true;
+    } else {
+        node = nodes.size();
+        nodes.push_back({key, move(value), true});
+    }
+
+    size_t idx = find_insert_slot(h);
+    if (ctrl[idx] == DELETED) --tombstones;
+    ctrl[idx] = h2(h);
+    slots[idx] = node;
     ++num_elements;
-    if (num_elements > table.size() * 0.7) rehash();
 }
 
-template<typename K, typename V>
-optional<V*> HashTable<K, V>::find(const K& key) {
-    size_t idx = get_index(key);
-    auto& chain = table[idx];
-    for (auto& p : chain) {
-        if (p.first == key) return &p.second;
+template<typename K, typename V, typename Hash>
+optional<V*> HashTable<K, V, Hash>::find(const K& key) {
+    long idx = find_slot(key, hash_of(key));
+    if (idx < 0) return nullopt;
+    return &nodes[slots[idx]].value;
+}
+
+template<typename K, typename V, typename Hash>
+optional<const V*> HashTable<K, V, Hash>::find(const K& key) const {
+    long idx = find_slot(key, hash_of(key));
+    if (idx < 0) return nullopt;
+    return &nodes[slots[idx]].value;
+}
+
+template<typename K, typename V, typename Hash>
+bool HashTable<K, V, Hash>::remove(const K& key) {
+    long idx = find_slot(key, hash_of(key));
+    if (idx < 0) return false;
+
+    size_t node = slots[idx];
+    nodes[node].value = V();
+    nodes[node].live = false;
+    free_nodes.push_back(node);
+
+    // A group that still has an EMPTY slot ends every probe that reaches it,
+    // so no key can sit past it on this slot's account.
+    const int8_t* group = ctrl.data() + (idx / GROUP_WIDTH) * GROUP_WIDTH;
+    if (match_byte(group, EMPTY)) {
+        ctrl[idx] = EMPTY;
+    } else {
+        ctrl[idx] = DELETED;
+        ++tombstones;
     }
-    return nullopt;
+    --num_elements;
+    return true;
 }
 
-template<typename K, typename V>
-optional<const V*> HashTable<K, V>::find(const K& key) const {
-    size_t idx = get_index(key);
-    const auto& chain = table[idx];
-    for (const auto& p : chain) {
-        if (p.first == key) return &p.second;
+template<typename K, typename V, typename Hash>
+size_t HashTable<K, V, Hash>::size() const {
+    return num_elements;
+}
+
+template<typename K, typename V, typename Hash>
+bool HashTable<K, V, Hash>::empty() const {
+    return num_elements == 0;
+}
+
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::clear() {
+    fill(ctrl.begin(), ctrl.end(), EMPTY);
+    nodes.clear();
+    free_nodes.clear();
+    num_elements = 0;
+    tombstones = 0;
+}
+
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::reserve(size_t count) {
+    if (count + tombstones > ctrl.size() * 7 / 8) {
+        rehash(capacity_for(count, GROUP_WIDTH));
     }
-    return nullopt;
-}
-
-template<typename K, typename V>
-bool HashTable<K, V>::remove(const K& key) {
-    size_t idx = get_index(key);
-    auto& chain = table[idx];
-    for (auto it = chain.begin(); it != chain.end(); ++it) {
-        if (it->first == key) {
-            chain.erase(it);
-            --num_elements;
-            return true;
-        }
+}
+
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::insert_many(vector<pair<K, V>> items) {
+    reserve(num_elements + items.size());
+    for (auto& item : items) {
+        insert(item.first, move(item.second));
     }
-    return false;
 }
 
-template<typename K, typename V>
-size_t HashTable<K, V>::size() const { 
-    return num_elements; 
+template<typename K, typename V, typename Hash>
+vector<pair<K, V>> HashTable<K, V, Hash>::extract_all() {
+    vector<pair<K, V>> out;
+    out.reserve(num_elements);
+    for (auto& node : nodes) {
+        if (node.live) out.emplace_back(node.key, move(node.value));
+    }
+    clear();
+    return out;
 }
 
-template<typename K, typename V>
-bool HashTable<K, V>::empty() const { 
-    return num_elements == 0; 
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::for_each(const function<void(const K&, V&)>& fn) {
+    for (auto& node : nodes) {
+        if (node.live) fn(node.key, node.value);
+    }
 }
 
-template<typename K, typename V>
-void HashTable<K, V>::rehash() {
-    size_t new_size = table.size() * 2 + 1;
-    vector<list<pair<K, V>>> new_table(new_size);
-    for (const auto& chain : table) {
-        for (const auto& p : chain) {
-            size_t new_idx = hash_func(p.first) % new_size;
-            new_table[new_idx].push_back(p);
-        }
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::for_each(const function<void(const K&, const V&)>& fn) const {
+    for (const auto& node : nodes) {
+        if (node.live) fn(node.key, node.value);
     }
-    table = move(new_table);
 }
 
-template<typename K, typename V>
-size_t HashTable<K, V>::get_index(const K& key) const {
-    return hash_func(key) % table.size();
+template<typename K, typename V, typename Hash>
+void HashTable<K, V, Hash>::rehash(size_t new_capacity) {
+    new_capacity = max(new_capacity, ctrl.size());
+    vector<int8_t> old_ctrl(new_capacity, EMPTY);
+    vector<size_t> old_slots(new_capacity);
+    old_ctrl.swap(ctrl);
+    old_slots.swap(slots);
+    tombstones = 0;
+
+    for (size_t i = 0; i < old_ctrl.size(); ++i) {
+        if (old_ctrl[i] < 0) continue;
+        size_t h = hash_of(nodes[old_slots[i]].key);
+        size_t idx = find_insert_slot(h);
+        ctrl[idx] = h2(h);
+        slots[idx] = old_slots[i];
+    }
 }
 
 template class HashTable<int, Location>;
 template class HashTable<int, Vehicle>;
-template class HashTable<int, Delivery>;
\ No newline at end of file
+template class HashTable<int, Delivery>;
@@ -0,0 +1,170 @@
+#include "../include/linear_quadtree.hpp"
+#include "../include/spatial_kernels.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace {
+
+// Spreads the low 16 bits of v so that bit i lands on bit 2i.
+inline uint64_t spread_bits(uint64_t v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+}
+
+LinearQuadTree::LinearQuadTree(double minx, double miny, double maxx, double maxy)
+    : min_x(minx), min_y(miny), max_x(maxx), max_y(maxy) {}
+
+void LinearQuadTree::insert_location(Location* loc) {
+    if (!loc) return;
+    pending.push_back(loc);
+}
+
+size_t LinearQuadTree::size() const {
+    return items.size() + pending.size();
+}
+
+uint64_t LinearQuadTree::morton(double x, double y) const {
+    auto quantize = [](double v, double lo, double hi) -> uint64_t {
+        if (hi <= lo) return 0;
+        double t = (v - lo) / (hi - lo);
+        t = min(max(t, 0.0), 1.0);
+        return static_cast<uint64_t>(t * 65535.0);
+    };
+    return spread_bits(quantize(x, min_x, max_x)) | (spread_bits(quantize(y, min_y, max_y)) << 1);
+}
+
+void LinearQuadTree::build() {
+    if (pending.empty()) return;
+    vector<pair<uint64_t, Location*>> keyed;
+    keyed.reserve(items.size() + pending.size());
+    for (Location* loc : items) keyed.push_back({morton(loc->x, loc->y), loc});
+    for (Location* loc : pending) keyed.push_back({morton(loc->x, loc->y), loc});
+    pending.clear();
+    pending.shrink_to_fit();
+    sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    size_t n = keyed.size();
+    vector<uint64_t> codes(n);
+    items.resize(n);
+    xs.resize(n);
+    ys.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        codes[i] = keyed[i].first;
+        items[i] = keyed[i].second;
+        xs[i] = items[i]->x;
+        ys[i] = items[i]->y;
+    }
+
+    nodes.clear();
+    nodes.push_back({0, 0, 0, 0, 0, static_cast<uint32_t>(n), 0});
+    build_node(0, codes, 0);
+}
+
+void LinearQuadTree::build_node(uint32_t idx, const vector<uint64_t>& codes, int level) {
+    uint32_t begin = nodes[idx].begin;
+    uint32_t end = nodes[idx].end;
+
+    if (begin < end) {
+        auto [lo_x, hi_x] = minmax_element(xs.begin() + begin, xs.begin() + end);
+        auto [lo_y, hi_y] = minmax_element(ys.begin() + begin, ys.begin() + end);
+        nodes[idx].min_x = *lo_x;
+        nodes[idx].max_x = *hi_x;
+        nodes[idx].min_y = *lo_y;
+        nodes[idx].max_y = *hi_y;
+    }
+    if (end - begin <= LEAF_SIZE || level == LEVELS) return;
+
+    int shift = 2 * (LEVELS - 1 - level);
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    nodes[idx].first_child = first;
+
+    uint32_t split = begin;
+    for (uint64_t q = 0; q < 4; ++q) {
+        uint32_t stop = static_cast<uint32_t>(partition_point(codes.begin() + split, codes.begin() + end,
+            [&](uint64_t c) { return ((c >> shift) & 3) <= q; }) - codes.begin());
+        nodes.push_back({0, 0, 0, 0, split, stop, 0});
+        split = stop;
+    }
+    for (uint32_t c = 0; c < 4; ++c) {
+        if (nodes[first + c].begin < nodes[first + c].end) build_node(first + c, codes, level + 1);
+    }
+}
+
+double LinearQuadTree::box_dist2(const Node& n, double x, double y) const {
+    double dx = max({n.min_x - x, 0.0, x - n.max_x});
+    double dy = max({n.min_y - y, 0.0, y - n.max_y});
+    return dx*dx + dy*dy;
+}
+
+vector<Location*> LinearQuadTree::query_radius(double x, double y, double radius) const {
+    vector<Location*> result;
+    if (items.empty()) return result;
+
+    double r2 = radius * radius;
+    vector<uint32_t> hits;
+    vector<uint32_t> stack = {0};
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.begin == node.end || box_dist2(node, x, y) > r2) continue;
+
+        if (node.first_child) {
+            for (uint32_t c = 0; c < 4; ++c) stack.push_back(node.first_child + c);
+            continue;
+        }
+        // Leaves at the last level can exceed LEAF_SIZE when points coincide.
+        if (hits.size() < node.end - node.begin) hits.resize(node.end - node.begin);
+        size_t found = within_kernel(xs.data() + node.begin, ys.data() + node.begin,
+                                     node.end - node.begin, x, y, r2, hits.data());
+        for (size_t k = 0; k < found; ++k) result.push_back(items[node.begin + hits[k]]);
+    }
+    return result;
+}
+
+vector<Location*> LinearQuadTree::k_nearest(double x, double y, size_t k, const LocationFilter& filter) const {
+    vector<Location*> result;
+    if (k == 0 || items.empty()) return result;
+
+    // Nodes are pushed by box distance and items by their own distance; an
+    // entry with is_item set refers to the item arrays, otherwise to nodes.
+    struct Entry {
+        double dist;
+        uint32_t index;
+        bool is_item;
+        bool operator>(const Entry& o) const { return dist > o.dist; }
+    };
+    priority_queue<Entry, vector<Entry>, greater<Entry>> pq;
+    vector<double> dist;
+    pq.push({box_dist2(nodes[0], x, y), 0, false});
+
+    while (!pq.empty() && result.size() < k) {
+        Entry e = pq.top();
+        pq.pop();
+        if (e.is_item) {
+            result.push_back(items[e.index]);
+            continue;
+        }
+
+        const Node& node = nodes[e.index];
+        if (node.first_child) {
+            for (uint32_t c = 0; c < 4; ++c) {
+                const Node& child = nodes[node.first_child + c];
+                if (child.begin < child.end) pq.push({box_dist2(child, x, y), node.first_child + c, false});
+            }
+            continue;
+        }
+        if (dist.size() < node.end - node.begin) dist.resize(node.end - node.begin);
+        dist2_kernel(xs.data() + node.begin, ys.data() + node.begin, node.end - node.begin, x, y, dist.data());
+        for (uint32_t i = node.begin; i < node.end; ++i) {
+            if (filter && !filter(items[i])) continue;
+            pq.push({dist[i - node.begin], i, true});
+        }
+    }
+    return result;
+}
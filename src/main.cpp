@@ -3,11 +3,15 @@
 #include "../include/quadtree.hpp"
 #include "../include/scheduler.hpp"
 #include "../include/file_io.hpp"
+#include "../include/snapshot.hpp"
+#include "../include/traffic_feed.hpp"
 #include "../include/utils.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <iomanip>
+#include <cstdlib>
+#include <memory>
 
 using namespace std;
 
@@ -15,14 +19,42 @@ int main() {
     try {
         cout << "=== Smart City Delivery & Traffic Management System ===\n\n";
         RoadNetwork graph;
-        HashTable<int, Location> loc_db(101, [](int k){ return static_cast<size_t>(k); });
+        HashTable<int, Location> loc_db(101);
         vector<Location*> all_locs;
 
-        cout << "Loading city map...\n";
-        if (!load_city_map("city_map.txt", graph)) cerr << "Warning: Could not load city map\n";
-        cout << "Loading locations...\n";
-        if (!load_locations("locations.txt", loc_db, all_locs)) cerr << "Warning: Could not load locations\n";
+        HashTable<int, Vehicle> vehicle_db(101);
+        vector<int> vehicle_ids;
+
+        // SNAPSHOT=build parses the text inputs and writes them to
+        // SNAPSHOT_FILE; SNAPSHOT=load starts from that file instead, falling
+        // back to the text inputs if it is missing or unusable.
+        const char* snapshot_env = getenv("SNAPSHOT");
+        string snapshot_mode = snapshot_env ? snapshot_env : "";
+        const char* snapshot_file_env = getenv("SNAPSHOT_FILE");
+        string snapshot_file = snapshot_file_env ? snapshot_file_env : "city.snap";
+        bool from_snapshot = false;
+        if (snapshot_mode == "load") {
+            cout << "Loading snapshot " << snapshot_file << "...\n";
+            try {
+                from_snapshot = load_snapshot(snapshot_file, graph, loc_db, all_locs, vehicle_db, vehicle_ids);
+                if (!from_snapshot) cerr << "Warning: Could not open snapshot\n";
+            } catch (const exception& e) {
+                cerr << "Warning: " << e.what() << "\n";
+            }
+        }
+
+        if (!from_snapshot) {
+            cout << "Loading city map...\n";
+            if (!load_city_map("city_map.txt", graph)) cerr << "Warning: Could not load city map\n";
+            cout << "Loading locations...\n";
+            if (!load_locations("locations.txt", loc_db, all_locs)) cerr << "Warning: Could not load locations\n";
+        }
         cout << "Loaded " << all_locs.size() << " locations\n";
+        for (const auto* loc : all_locs) {
+            graph.set_node_position(loc->id, loc->x, loc->y);
+            if (loc->type == "warehouse" || loc->type == "depot") graph.add_hub(loc->id);
+        }
+        graph.set_routing_mode(RoutingMode::Landmarks);
         double minx = 0, maxx = 100, miny = 0, maxy = 100;
         if (!all_locs.empty()) {
             minx = maxx = all_locs[0]->x;
@@ -39,16 +71,29 @@ int main() {
         }
 
         Scheduler scheduler(graph, loc_db, minx, miny, maxx, maxy);
+        if (const char* index = getenv("VEHICLE_INDEX"); index && string(index) == "grid") {
+            scheduler.set_vehicle_index(VehicleIndexKind::Grid);
+        }
 
         cout << "Building location QuadTree...\n";
         for (auto* loc : all_locs) {
             if (loc) scheduler.add_location_to_quadtree(loc);
         }
+        scheduler.build_location_index();
 
-        HashTable<int, Vehicle> vehicle_db(101, [](int k){ return static_cast<size_t>(k); });
-        vector<int> vehicle_ids;
-        cout << "Loading vehicles...\n";
-        if (!load_vehicles("vehicles.txt", vehicle_db, loc_db, vehicle_ids)) cerr << "Warning: Could not load vehicles\n";
+        if (!from_snapshot) {
+            cout << "Loading vehicles...\n";
+            if (!load_vehicles("vehicles.txt", vehicle_db, loc_db, vehicle_ids)) cerr << "Warning: Could not load vehicles\n";
+        }
+        if (snapshot_mode == "build") {
+            cout << "Writing snapshot " << snapshot_file << "...\n";
+            if (!write_snapshot(snapshot_file, graph, all_locs, vehicle_db, vehicle_ids)) {
+                cerr << "Error: Could not write snapshot\n";
+                return 1;
+            }
+            cout << "Snapshot written\n";
+            return 0;
+        }
         cout << "Registering vehicles...\n";
         int veh_count = 0;
         for (int id : vehicle_ids) {
@@ -61,7 +106,7 @@ int main() {
         cout << "Registered " << veh_count << " vehicles\n";
 
         vector<Delivery> deliveries;
-        HashTable<int, Delivery> delivery_db(101, [](int k){ return static_cast<size_t>(k); });
+        HashTable<int, Delivery> delivery_db(101);
         cout << "Loading deliveries...\n";
         if (!load_deliveries("deliveries.txt", deliveries, delivery_db)) cerr << "Warning: Could not load deliveries\n";
         cout << "Loaded " << deliveries.size() << " deliveries\n";
@@ -71,10 +116,40 @@ int main() {
             scheduler.add_delivery(del);
         }
 
-        cout << "Applying traffic updates...\n";
-        load_traffic_updates("traffic_updates.txt", graph);
+        // TRAFFIC_STREAM=<file or pipe> tails the feed on its own thread while
+        // dispatch runs, instead of applying traffic_updates.txt up front.
+        unique_ptr<TrafficFeed> feed;
+        if (const char* stream = getenv("TRAFFIC_STREAM"); stream && *stream) {
+            cout << "Streaming traffic updates from " << stream << "...\n";
+            feed = make_unique<TrafficFeed>(stream);
+            if (feed->start()) {
+                scheduler.set_traffic_feed(feed.get());
+            } else {
+                cerr << "Warning: Could not open traffic stream\n";
+                feed.reset();
+            }
+        } else {
+            cout << "Applying traffic updates...\n";
+            load_traffic_updates("traffic_updates.txt", graph);
+        }
         cout << "Processing all deliveries...\n";
-        scheduler.process_deliveries();
+        if (const char* dispatch = getenv("DISPATCH"); dispatch && string(dispatch) == "batch") {
+            scheduler.process_deliveries_batch();
+        } else {
+            scheduler.process_deliveries();
+        }
+
+        if (feed) {
+            feed->stop();
+            feed->apply_pending(graph);
+            scheduler.set_traffic_feed(nullptr);
+            auto fs = feed->stats();
+            cout << "Traffic feed: " << fs.updates << " updates (" << fs.coalesced << " coalesced, "
+                 << fs.malformed << " malformed) in " << fs.batches << " batches, "
+                 << fs.applied << " edge changes\n";
+            cout << "Traffic lag: mean " << fixed << setprecision(1) << fs.mean_lag_ms << " ms, max "
+                 << fs.max_lag_ms << " ms; " << fs.updates_per_second << " updates/s\n";
+        }
 
         cout << "\n=== FINAL STATISTICS ===\n";
         auto stats = scheduler.get_stats();
@@ -101,9 +176,9 @@ int main() {
         cout << "\n=== Vehicle Status & Routes ===\n";
         int active = 0;
         for (int id : vehicle_ids) {
-            auto v_opt = scheduler.get_vehicle_db().find(id);
-            if (!v_opt) continue;
-            const Vehicle* v = *v_opt;
+            auto v_ref = scheduler.get_vehicle_db().find(id);
+            if (!v_ref) continue;
+            const Vehicle* v = v_ref.get();
             if (v->assigned_deliveries.empty() && v->route.empty()) continue;
             active++;
             cout << "Vehicle " << v->id
@@ -0,0 +1,154 @@
+#include "../include/parallel_sssp.hpp"
+#include "../include/road_network.hpp"
+#include "../include/priority_queue.hpp"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <limits>
+
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+constexpr size_t GRAIN = 256;
+
+void sequential_sssp(const CsrGraph& g, int s, vector<double>& dist) {
+    dist.assign(g.num_nodes(), INF);
+    if (s < 0) return;
+    RadixFrontier pq;
+    dist[s] = 0.0;
+    pq.push(s, 0.0);
+
+    while (!pq.empty()) {
+        auto [cost, u] = pq.pop();
+        if (cost > dist[u]) continue;
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            double alt = cost + g.weights[i];
+            if (alt < dist[v]) {
+                dist[v] = alt;
+                pq.push(v, alt);
+            }
+        }
+    }
+}
+
+}
+
+ParallelSSSP::ParallelSSSP(const RoadNetwork& g, ThreadPool& p) : graph(g), pool(p) {}
+
+void ParallelSSSP::set_delta(double d) {
+    delta = d;
+}
+
+double ParallelSSSP::pick_delta(const CsrGraph& g) const {
+    double total = 0.0;
+    for (double w : g.weights) total += w;
+    double mean = g.num_edges() > 0 ? total / g.num_edges() : 0.0;
+    return mean > 0.0 ? mean : 1.0;
+}
+
+vector<double> ParallelSSSP::run(int source) {
+    const CsrGraph& g = graph.csr();
+    size_t n = g.num_nodes();
+    vector<double> result(n, INF);
+    int s = g.index_of(source);
+    if (s < 0) return result;
+
+    const double step = delta > 0.0 ? delta : pick_delta(g);
+    unique_ptr<atomic<double>[]> dist(new atomic<double>[n]);
+    for (size_t v = 0; v < n; ++v) dist[v].store(INF, memory_order_relaxed);
+
+    vector<vector<int>> local(pool.size());
+    map<size_t, vector<int>> buckets;
+    vector<unsigned long> mark(n, 0);
+    vector<size_t> settled_in(n, numeric_limits<size_t>::max());
+    unsigned long mark_id = 0;
+
+    auto bucket_of = [&](int v) {
+        return static_cast<size_t>(dist[v].load(memory_order_relaxed) / step);
+    };
+    auto relax = [&](int v, double nd, size_t worker) {
+        double old = dist[v].load(memory_order_relaxed);
+        while (nd < old) {
+            if (dist[v].compare_exchange_weak(old, nd, memory_order_relaxed)) {
+                local[worker].push_back(v);
+                return;
+            }
+        }
+    };
+    auto merge = [&]() {
+        ++mark_id;
+        for (auto& buf : local) {
+            for (int v : buf) {
+                if (mark[v] == mark_id) continue;
+                mark[v] = mark_id;
+                buckets[bucket_of(v)].push_back(v);
+            }
+            buf.clear();
+        }
+    };
+
+    dist[s].store(0.0, memory_order_relaxed);
+    buckets[0].push_back(s);
+
+    while (!buckets.empty()) {
+        size_t cur = buckets.begin()->first;
+        vector<int> settled;
+
+        while (true) {
+            auto it = buckets.find(cur);
+            if (it == buckets.end()) break;
+            vector<int> frontier = move(it->second);
+            buckets.erase(it);
+
+            ++mark_id;
+            size_t kept = 0;
+            for (int v : frontier) {
+                if (mark[v] == mark_id || bucket_of(v) != cur) continue;
+                mark[v] = mark_id;
+                frontier[kept++] = v;
+                if (settled_in[v] != cur) {
+                    settled_in[v] = cur;
+                    settled.push_back(v);
+                }
+            }
+            frontier.resize(kept);
+
+            pool.parallel_for(frontier.size(), GRAIN, [&](size_t begin, size_t end, size_t worker) {
+                for (size_t k = begin; k < end; ++k) {
+                    int u = frontier[k];
+                    double du = dist[u].load(memory_order_relaxed);
+                    for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+                        if (g.weights[i] <= step) relax(g.targets[i], du + g.weights[i], worker);
+                    }
+                }
+            });
+            merge();
+        }
+
+        pool.parallel_for(settled.size(), GRAIN, [&](size_t begin, size_t end, size_t worker) {
+            for (size_t k = begin; k < end; ++k) {
+                int u = settled[k];
+                double du = dist[u].load(memory_order_relaxed);
+                for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+                    if (g.weights[i] > step) relax(g.targets[i], du + g.weights[i], worker);
+                }
+            }
+        });
+        merge();
+    }
+
+    for (size_t v = 0; v < n; ++v) result[v] = dist[v].load(memory_order_relaxed);
+    return result;
+}
+
+vector<vector<double>> ParallelSSSP::run_batch(const vector<int>& sources) {
+    const CsrGraph& g = graph.csr();
+    vector<vector<double>> results(sources.size());
+    pool.parallel_for(sources.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) {
+            sequential_sssp(g, g.index_of(sources[i]), results[i]);
+        }
+    });
+    return results;
+}
@@ -0,0 +1,143 @@
+#include "../include/path_cache.hpp"
+#include <algorithm>
+#include <limits>
+
+uint64_t PathCache::key_of(int a, int b) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+PathCache::Shard& PathCache::shard_of(uint64_t key) {
+    uint64_t h = key * 0x9e3779b97f4a7c15ULL;
+    return shards[h >> 60];
+}
+
+PathCache::PathCache(size_t capacity) : per_shard(max<size_t>(1, (capacity + SHARDS - 1) / SHARDS)) {}
+
+void PathCache::unlink(Shard& shard, list<Slot>::iterator it) {
+    const auto& path = it->result.path;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        auto e = shard.by_edge.find(key_of(path[i], path[i + 1]));
+        if (e == shard.by_edge.end()) continue;
+        e->second.erase(it->key);
+        if (e->second.empty()) shard.by_edge.erase(e);
+    }
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+bool PathCache::lookup(int start, int goal, Result& out) {
+    uint64_t key = key_of(start, goal);
+    Shard& shard = shard_of(key);
+    lock_guard<mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        misses.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    out = it->second->result;
+    hits.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void PathCache::store(int start, int goal, Result result) {
+    uint64_t key = key_of(start, goal);
+    Shard& shard = shard_of(key);
+    lock_guard<mutex> lock(shard.mtx);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) unlink(shard, it->second);
+
+    shard.lru.push_front({key, move(result)});
+    shard.index[key] = shard.lru.begin();
+    const auto& path = shard.lru.front().result.path;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        shard.by_edge[key_of(path[i], path[i + 1])].insert(key);
+    }
+
+    while (shard.lru.size() > per_shard) {
+        unlink(shard, prev(shard.lru.end()));
+        evictions.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+// The edge index of every shard is consulted, since a path's key and its
+// edges hash to different shards.
+size_t PathCache::invalidate_edge(int from, int to) {
+    uint64_t edge = key_of(from, to);
+    size_t dropped = 0;
+    for (auto& shard : shards) {
+        lock_guard<mutex> lock(shard.mtx);
+        auto e = shard.by_edge.find(edge);
+        if (e == shard.by_edge.end()) continue;
+        vector<uint64_t> keys(e->second.begin(), e->second.end());
+        for (uint64_t key : keys) {
+            auto it = shard.index.find(key);
+            if (it == shard.index.end()) continue;
+            unlink(shard, it->second);
+            ++dropped;
+        }
+    }
+    invalidations.fetch_add(dropped, memory_order_relaxed);
+    return dropped;
+}
+
+size_t PathCache::invalidate_if(const function<bool(int, int, const Result&)>& stale) {
+    size_t dropped = 0;
+    for (auto& shard : shards) {
+        lock_guard<mutex> lock(shard.mtx);
+        for (auto it = shard.lru.begin(); it != shard.lru.end();) {
+            auto cur = it++;
+            int start = static_cast<int>(static_cast<uint32_t>(cur->key >> 32));
+            int goal = static_cast<int>(static_cast<uint32_t>(cur->key));
+            if (!stale(start, goal, cur->result)) continue;
+            unlink(shard, cur);
+            ++dropped;
+        }
+    }
+    invalidations.fetch_add(dropped, memory_order_relaxed);
+    return dropped;
+}
+
+// Unreachable entries (infinite cost) are left out, so the result stays
+// usable as a search bound.
+double PathCache::max_cost() const {
+    double worst = 0.0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard.mtx);
+        for (const auto& slot : shard.lru) {
+            if (slot.result.cost != numeric_limits<double>::infinity()) worst = max(worst, slot.result.cost);
+        }
+    }
+    return worst;
+}
+
+size_t PathCache::size() const {
+    size_t n = 0;
+    for (const auto& shard : shards) {
+        lock_guard<mutex> lock(shard.mtx);
+        n += shard.lru.size();
+    }
+    return n;
+}
+
+void PathCache::clear() {
+    size_t dropped = 0;
+    for (auto& shard : shards) {
+        lock_guard<mutex> lock(shard.mtx);
+        dropped += shard.lru.size();
+        shard.lru.clear();
+        shard.index.clear();
+        shard.by_edge.clear();
+    }
+    invalidations.fetch_add(dropped, memory_order_relaxed);
+}
+
+PathCache::Stats PathCache::stats() const {
+    Stats s;
+    s.hits = hits.load(memory_order_relaxed);
+    s.misses = misses.load(memory_order_relaxed);
+    s.invalidations = invalidations.load(memory_order_relaxed);
+    s.evictions = evictions.load(memory_order_relaxed);
+    s.size = size();
+    return s;
+}
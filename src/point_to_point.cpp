@@ -0,0 +1,334 @@
+#include "../include/point_to_point.hpp"
+#include "../include/road_network.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+constexpr size_t DEFAULT_LANDMARKS = 8;
+
+void full_sssp(const CsrGraph& g, int src, bool reverse, vector<double>& dist) {
+    using P = pair<double, int>;
+    dist.assign(g.num_nodes(), INF);
+    priority_queue<P, vector<P>, greater<P>> pq;
+    dist[src] = 0.0;
+    pq.push({0.0, src});
+
+    while (!pq.empty()) {
+        auto [cost, u] = pq.top();
+        pq.pop();
+        if (cost > dist[u]) continue;
+
+        if (!reverse) {
+            for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+                int v = g.targets[i];
+                double alt = cost + g.weights[i];
+                if (alt < dist[v]) {
+                    dist[v] = alt;
+                    pq.push({alt, v});
+                }
+            }
+        } else {
+            for (size_t r = g.rev_offsets[u]; r < g.rev_offsets[u + 1]; ++r) {
+                int v = g.rev_sources[r];
+                double alt = cost + g.weights[g.rev_slots[r]];
+                if (alt < dist[v]) {
+                    dist[v] = alt;
+                    pq.push({alt, v});
+                }
+            }
+        }
+    }
+}
+
+}
+
+PointToPointRouter::PointToPointRouter(const RoadNetwork& g)
+    : graph(g), wanted_landmarks(DEFAULT_LANDMARKS) {}
+
+void PointToPointRouter::set_mode(HeuristicMode m) {
+    mode = m;
+}
+
+HeuristicMode PointToPointRouter::get_mode() const {
+    return mode;
+}
+
+void PointToPointRouter::set_landmarks(const vector<int>& ids) {
+    landmark_ids = ids;
+    wanted_landmarks = 0;
+    lm_weights.clear();
+}
+
+void PointToPointRouter::select_landmarks(size_t count) {
+    landmark_ids.clear();
+    wanted_landmarks = count;
+    lm_weights.clear();
+}
+
+const vector<int>& PointToPointRouter::landmarks() const {
+    return landmark_ids;
+}
+
+size_t PointToPointRouter::last_settled() const {
+    return settled;
+}
+
+void PointToPointRouter::prepare() {
+    const CsrGraph& g = graph.csr();
+    bool rebuilt = !prepared || g.generation != seen_generation;
+
+    if (rebuilt) {
+        size_t n = g.num_nodes();
+        for (Side* side : {&fwd, &bwd}) {
+            side->dist.assign(n, INF);
+            side->pot.assign(n, 0.0);
+            side->parent.assign(n, -1);
+            side->stamp.assign(n, 0);
+        }
+        cur_stamp = 0;
+        if (wanted_landmarks > 0) landmark_ids.clear();
+        lm_weights.clear();
+        compute_scale(g);
+    } else if (graph.traffic_epoch() != seen_epoch) {
+        compute_scale(g);
+    }
+
+    if (mode == HeuristicMode::Landmarks && landmarks_stale(g)) {
+        compute_landmarks(g);
+    }
+
+    seen_generation = g.generation;
+    seen_epoch = graph.traffic_epoch();
+    prepared = true;
+}
+
+void PointToPointRouter::compute_scale(const CsrGraph& g) {
+    euclid_scale = INF;
+    for (size_t u = 0; u < g.num_nodes(); ++u) {
+        if (!g.has_position(u)) {
+            euclid_scale = 0.0;
+            return;
+        }
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            double len = hypot(g.xs[u] - g.xs[v], g.ys[u] - g.ys[v]);
+            if (len > 0.0) euclid_scale = min(euclid_scale, g.weights[i] / len);
+        }
+    }
+    if (euclid_scale == INF || euclid_scale < 0.0) euclid_scale = 0.0;
+}
+
+bool PointToPointRouter::landmarks_stale(const CsrGraph& g) const {
+    if (lm_weights.size() != g.num_edges()) return true;
+    for (size_t i = 0; i < lm_weights.size(); ++i) {
+        if (g.weights[i] < lm_weights[i]) return true;
+    }
+    return false;
+}
+
+void PointToPointRouter::compute_landmarks(const CsrGraph& g) {
+    size_t n = g.num_nodes();
+    vector<int> chosen;
+    vector<vector<double>> from;
+
+    if (wanted_landmarks == 0) {
+        for (int id : landmark_ids) {
+            int idx = g.index_of(id);
+            if (idx >= 0) chosen.push_back(idx);
+        }
+        for (int idx : chosen) {
+            from.emplace_back();
+            full_sssp(g, idx, false, from.back());
+        }
+    } else if (n > 0) {
+        size_t count = min(wanted_landmarks, n);
+        vector<double> min_d(n, INF);
+        vector<double> seed;
+        full_sssp(g, 0, false, seed);
+        int next = 0;
+        for (size_t v = 0; v < n; ++v) {
+            if (seed[v] == INF) { next = static_cast<int>(v); break; }
+            if (seed[v] > seed[next]) next = static_cast<int>(v);
+        }
+
+        while (chosen.size() < count) {
+            chosen.push_back(next);
+            from.emplace_back();
+            full_sssp(g, next, false, from.back());
+            const auto& d = from.back();
+            next = -1;
+            for (size_t v = 0; v < n; ++v) {
+                min_d[v] = min(min_d[v], d[v]);
+                if (min_d[v] == 0.0) continue;
+                if (next < 0 || min_d[v] > min_d[next]) next = static_cast<int>(v);
+            }
+            if (next < 0) break;
+        }
+
+        landmark_ids.clear();
+        for (int idx : chosen) landmark_ids.push_back(g.id_of(idx));
+    }
+
+    size_t k = chosen.size();
+    lm_count = k;
+    lm_from.assign(n * k, INF);
+    lm_to.assign(n * k, INF);
+    vector<double> to;
+    for (size_t l = 0; l < k; ++l) {
+        full_sssp(g, chosen[l], true, to);
+        for (size_t v = 0; v < n; ++v) {
+            lm_from[v * k + l] = from[l][v];
+            lm_to[v * k + l] = to[v];
+        }
+    }
+    lm_weights = g.weights;
+}
+
+double PointToPointRouter::potential(const CsrGraph& g, int v, int target, bool reverse) const {
+    double h = 0.0;
+    if (mode != HeuristicMode::None && euclid_scale > 0.0) {
+        h = euclid_scale * hypot(g.xs[v] - g.xs[target], g.ys[v] - g.ys[target]);
+    }
+    if (mode != HeuristicMode::Landmarks || lm_count == 0) return h;
+
+    size_t k = lm_count;
+    const double* from_v = &lm_from[v * k];
+    const double* to_v = &lm_to[v * k];
+    const double* from_t = &lm_from[target * k];
+    const double* to_t = &lm_to[target * k];
+
+    for (size_t l = 0; l < k; ++l) {
+        if (!reverse) {
+            // d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L)
+            if (from_v[l] != INF) {
+                if (from_t[l] == INF) return INF;
+                h = max(h, from_t[l] - from_v[l]);
+            }
+            if (to_t[l] != INF) {
+                if (to_v[l] == INF) return INF;
+                h = max(h, to_v[l] - to_t[l]);
+            }
+        } else {
+            // d(s,v) >= d(L,v) - d(L,s) and d(s,v) >= d(s,L) - d(v,L)
+            if (from_t[l] != INF) {
+                if (from_v[l] == INF) return INF;
+                h = max(h, from_v[l] - from_t[l]);
+            }
+            if (to_v[l] != INF) {
+                if (to_t[l] == INF) return INF;
+                h = max(h, to_t[l] - to_v[l]);
+            }
+        }
+    }
+    return h;
+}
+
+void PointToPointRouter::touch(Side& side, int v) {
+    if (side.stamp[v] == cur_stamp) return;
+    side.stamp[v] = cur_stamp;
+    side.dist[v] = INF;
+    side.parent[v] = -1;
+}
+
+bool PointToPointRouter::search(int s, int t, int& meet, double& best) {
+    const CsrGraph& g = graph.csr();
+
+    if (++cur_stamp == 0) {
+        fill(fwd.stamp.begin(), fwd.stamp.end(), 0);
+        fill(bwd.stamp.begin(), bwd.stamp.end(), 0);
+        cur_stamp = 1;
+    }
+    settled = 0;
+    fwd.pq = MinQueue();
+    bwd.pq = MinQueue();
+    meet = -1;
+    best = INF;
+
+    touch(fwd, s);
+    fwd.pot[s] = potential(g, s, t, false);
+    touch(bwd, t);
+    bwd.pot[t] = potential(g, t, s, true);
+    if (fwd.pot[s] == INF || bwd.pot[t] == INF) return false;
+
+    fwd.dist[s] = 0.0;
+    bwd.dist[t] = 0.0;
+    fwd.pq.push({fwd.pot[s], s});
+    bwd.pq.push({bwd.pot[t], t});
+
+    while (!fwd.pq.empty() && !bwd.pq.empty()) {
+        if (fwd.pq.top().first >= best || bwd.pq.top().first >= best) break;
+
+        bool forward = fwd.pq.top().first <= bwd.pq.top().first;
+        Side& side = forward ? fwd : bwd;
+        Side& other = forward ? bwd : fwd;
+        int target = forward ? t : s;
+
+        auto [key, u] = side.pq.top();
+        side.pq.pop();
+        if (key > side.dist[u] + side.pot[u]) continue;
+        ++settled;
+
+        size_t begin = forward ? g.offsets[u] : g.rev_offsets[u];
+        size_t end = forward ? g.offsets[u + 1] : g.rev_offsets[u + 1];
+        for (size_t i = begin; i < end; ++i) {
+            int v = forward ? g.targets[i] : g.rev_sources[i];
+            double w = forward ? g.weights[i] : g.weights[g.rev_slots[i]];
+
+            if (side.stamp[v] != cur_stamp) {
+                touch(side, v);
+                side.pot[v] = potential(g, v, target, !forward);
+            }
+            if (side.pot[v] == INF) continue;
+
+            double alt = side.dist[u] + w;
+            if (alt < side.dist[v]) {
+                side.dist[v] = alt;
+                side.parent[v] = u;
+                side.pq.push({alt + side.pot[v], v});
+
+                if (other.stamp[v] == cur_stamp && alt + other.dist[v] < best) {
+                    best = alt + other.dist[v];
+                    meet = v;
+                }
+            }
+        }
+    }
+
+    return meet >= 0;
+}
+
+vector<int> PointToPointRouter::shortest_path(int start, int goal) {
+    if (start == goal) return {start};
+    prepare();
+    const CsrGraph& g = graph.csr();
+    int s = g.index_of(start);
+    int t = g.index_of(goal);
+    if (s < 0 || t < 0) return {};
+
+    int meet;
+    double best;
+    if (!search(s, t, meet, best)) return {};
+
+    vector<int> path;
+    for (int at = meet; at != -1; at = fwd.parent[at]) path.push_back(g.id_of(at));
+    reverse(path.begin(), path.end());
+    for (int at = bwd.parent[meet]; at != -1; at = bwd.parent[at]) path.push_back(g.id_of(at));
+    return path;
+}
+
+double PointToPointRouter::distance(int start, int goal) {
+    if (start == goal) return 0.0;
+    prepare();
+    const CsrGraph& g = graph.csr();
+    int s = g.index_of(start);
+    int t = g.index_of(goal);
+    if (s < 0 || t < 0) return INF;
+
+    int meet;
+    double best;
+    search(s, t, meet, best);
+    return best;
+}
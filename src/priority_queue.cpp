@@ -3,77 +3,269 @@
 #include <algorithm>
 #include <stdexcept>
 
-template<typename T, typename Compare>
-void PriorityQueue<T, Compare>::heapify_up(size_t idx) {
+template<typename T, typename Compare, size_t D>
+typename PriorityQueue<T, Compare, D>::Handle PriorityQueue<T, Compare, D>::acquire() {
+    if (!free_handles.empty()) {
+        Handle h = free_handles.back();
+        free_handles.pop_back();
+        return h;
+    }
+    pos.push_back(NONE);
+    return pos.size() - 1;
+}
+
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::sift_up(size_t idx) {
+    Slot moving = move(heap[idx]);
     while (idx > 0) {
-        size_t parent = (idx - 1) / 2;
-        if (comp(heap[idx], heap[parent])) {
-            swap(heap[idx], heap[parent]);
-            idx = parent;
-        } else {
-            break;
-        }
+        size_t parent = (idx - 1) / D;
+        if (!comp(moving.item, heap[parent].item)) break;
+        heap[idx] = move(heap[parent]);
+        pos[heap[idx].handle] = idx;
+        idx = parent;
     }
+    heap[idx] = move(moving);
+    pos[heap[idx].handle] = idx;
 }
 
-template<typename T, typename Compare>
-void PriorityQueue<T, Compare>::heapify_down(size_t idx) {
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::sift_down(size_t idx) {
     size_t n = heap.size();
+    Slot moving = move(heap[idx]);
     while (true) {
-        size_t left = 2 * idx + 1;
-        size_t right = 2 * idx + 2;
-        size_t smallest = idx;
-        if (left < n && comp(heap[left], heap[smallest])) smallest = left;
-        if (right < n && comp(heap[right], heap[smallest])) smallest = right;
-        if (smallest != idx) {
-            swap(heap[idx], heap[smallest]);
-            idx = smallest;
-        } else {
-            break;
+        size_t first = D * idx + 1;
+        if (first >= n) break;
+        size_t last = min(first + D, n);
+        size_t best = first;
+        for (size_t c = first + 1; c < last; ++c) {
+            if (comp(heap[c].item, heap[best].item)) best = c;
         }
+        if (!comp(heap[best].item, moving.item)) break;
+        heap[idx] = move(heap[best]);
+        pos[heap[idx].handle] = idx;
+        idx = best;
     }
+    heap[idx] = move(moving);
+    pos[heap[idx].handle] = idx;
 }
 
-template<typename T, typename Compare>
-void PriorityQueue<T, Compare>::push(T item) {
-    heap.push_back(move(item));
-    heapify_up(heap.size() - 1);
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::remove_at(size_t idx) {
+    pos[heap[idx].handle] = NONE;
+    free_handles.push_back(heap[idx].handle);
+    if (idx + 1 == heap.size()) {
+        heap.pop_back();
+        return;
+    }
+    heap[idx] = move(heap.back());
+    heap.pop_back();
+    pos[heap[idx].handle] = idx;
+    if (idx > 0 && comp(heap[idx].item, heap[(idx - 1) / D].item)) {
+        sift_up(idx);
+    } else {
+        sift_down(idx);
+    }
 }
 
-template<typename T, typename Compare>
-T PriorityQueue<T, Compare>::pop() {
+template<typename T, typename Compare, size_t D>
+typename PriorityQueue<T, Compare, D>::Handle PriorityQueue<T, Compare, D>::push(T item) {
+    Handle h = acquire();
+    heap.push_back({move(item), h});
+    sift_up(heap.size() - 1);
+    return h;
+}
+
+template<typename T, typename Compare, size_t D>
+T PriorityQueue<T, Compare, D>::pop() {
     if (empty()) throw runtime_error("PQ empty");
-    T item = move(heap[0]);
-    heap[0] = move(heap.back());
-    heap.pop_back();
-    if (!empty()) heapify_down(0);
+    T item = move(heap[0].item);
+    remove_at(0);
     return item;
 }
 
-template<typename T, typename Compare>
-const T& PriorityQueue<T, Compare>::top() const {
+template<typename T, typename Compare, size_t D>
+const T& PriorityQueue<T, Compare, D>::top() const {
     if (empty()) throw runtime_error("PQ empty");
-    return heap[0];
+    return heap[0].item;
 }
 
-template<typename T, typename Compare>
-bool PriorityQueue<T, Compare>::empty() const {
+template<typename T, typename Compare, size_t D>
+typename PriorityQueue<T, Compare, D>::Handle PriorityQueue<T, Compare, D>::top_handle() const {
+    if (empty()) throw runtime_error("PQ empty");
+    return heap[0].handle;
+}
+
+template<typename T, typename Compare, size_t D>
+bool PriorityQueue<T, Compare, D>::empty() const {
     return heap.empty();
 }
 
-template<typename T, typename Compare>
-size_t PriorityQueue<T, Compare>::size() const {
+template<typename T, typename Compare, size_t D>
+size_t PriorityQueue<T, Compare, D>::size() const {
     return heap.size();
 }
 
-template<typename T, typename Compare>
-void PriorityQueue<T, Compare>::update_priority(size_t index, const T& new_value) {
-    if (index >= heap.size()) {
-        throw std::out_of_range("Invalid index in update_priority");
+template<typename T, typename Compare, size_t D>
+bool PriorityQueue<T, Compare, D>::contains(Handle h) const {
+    return h < pos.size() && pos[h] != NONE;
+}
+
+template<typename T, typename Compare, size_t D>
+const T& PriorityQueue<T, Compare, D>::get(Handle h) const {
+    if (!contains(h)) throw out_of_range("Invalid handle in get");
+    return heap[pos[h]].item;
+}
+
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::update(Handle h, T new_value) {
+    if (!contains(h)) throw out_of_range("Invalid handle in update");
+    size_t idx = pos[h];
+    bool up = comp(new_value, heap[idx].item);
+    heap[idx].item = move(new_value);
+    if (up) {
+        sift_up(idx);
+    } else {
+        sift_down(idx);
     }
-    heap[index] = new_value;
-    heapify_up(index);
-    heapify_down(index);
 }
 
-template class PriorityQueue<Delivery, DeliveryCompare>;
\ No newline at end of file
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::decrease_key(Handle h, T new_value) {
+    if (!contains(h)) throw out_of_range("Invalid handle in decrease_key");
+    size_t idx = pos[h];
+    if (comp(heap[idx].item, new_value)) throw invalid_argument("decrease_key would move element down");
+    heap[idx].item = move(new_value);
+    sift_up(idx);
+}
+
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::erase(Handle h) {
+    if (!contains(h)) throw out_of_range("Invalid handle in erase");
+    remove_at(pos[h]);
+}
+
+template<typename T, typename Compare, size_t D>
+vector<typename PriorityQueue<T, Compare, D>::Handle> PriorityQueue<T, Compare, D>::heapify(vector<T> items) {
+    clear();
+    size_t n = items.size();
+    heap.reserve(n);
+    pos.resize(n);
+    vector<Handle> handles(n);
+    for (size_t i = 0; i < n; ++i) {
+        heap.push_back({move(items[i]), i});
+        pos[i] = i;
+        handles[i] = i;
+    }
+    for (size_t i = n > 1 ? (n - 2) / D + 1 : 0; i-- > 0;) {
+        sift_down(i);
+    }
+    return handles;
+}
+
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::reserve(size_t n) {
+    heap.reserve(n);
+    pos.reserve(n);
+}
+
+template<typename T, typename Compare, size_t D>
+void PriorityQueue<T, Compare, D>::clear() {
+    heap.clear();
+    pos.clear();
+    free_handles.clear();
+}
+
+template class PriorityQueue<Delivery, DeliveryCompare>;
+template class PriorityQueue<pair<double, int>>;
+
+HeapFrontier::HeapFrontier(size_t nodes) : handle(nodes, Queue::NONE) {}
+
+void HeapFrontier::push(int v, double d) {
+    if (handle[v] == Queue::NONE) {
+        handle[v] = heap.push({d, v});
+    } else {
+        heap.decrease_key(handle[v], {d, v});
+    }
+}
+
+pair<double, int> HeapFrontier::pop() {
+    auto top = heap.pop();
+    handle[top.second] = Queue::NONE;
+    return top;
+}
+
+bool HeapFrontier::empty() const {
+    return heap.empty();
+}
+
+void HeapFrontier::clear() {
+    while (!heap.empty()) pop();
+}
+
+RadixFrontier::RadixFrontier(size_t) {}
+
+size_t RadixFrontier::bucket_of(uint64_t key, uint64_t last) {
+    return key == last ? 0 : 64 - __builtin_clzll(key ^ last);
+}
+
+bool RadixFrontier::farther(const Entry& a, const Entry& b) {
+    return a.dist > b.dist;
+}
+
+// Moves every entry into bucket 0 and keeps it as one heap from now on.
+void RadixFrontier::fall_back() {
+    exact = true;
+    for (size_t i = 1; i < 65; ++i) {
+        buckets[0].insert(buckets[0].end(), buckets[i].begin(), buckets[i].end());
+        buckets[i].clear();
+    }
+    make_heap(buckets[0].begin(), buckets[0].end(), farther);
+}
+
+void RadixFrontier::push(int v, double d) {
+    uint64_t key = 0;
+    if (!exact) {
+        // 1.8e19 is just below 2^64; anything outside [0, 2^64) has no key.
+        bool keyed = d >= 0.0 && d * SCALE < 1.8e19;
+        if (keyed) key = static_cast<uint64_t>(d * SCALE);
+        if (!keyed || key < last) fall_back();
+    }
+    size_t b = exact ? 0 : bucket_of(key, last);
+    buckets[b].push_back({key, d, v});
+    if (b == 0) push_heap(buckets[0].begin(), buckets[0].end(), farther);
+    ++count;
+}
+
+pair<double, int> RadixFrontier::pop() {
+    if (count == 0) throw runtime_error("PQ empty");
+    if (buckets[0].empty()) {
+        size_t i = 1;
+        while (buckets[i].empty()) ++i;
+        uint64_t lowest = buckets[i][0].key;
+        for (const auto& e : buckets[i]) lowest = min(lowest, e.key);
+        last = lowest;
+        for (const auto& e : buckets[i]) buckets[bucket_of(e.key, last)].push_back(e);
+        buckets[i].clear();
+        make_heap(buckets[0].begin(), buckets[0].end(), farther);
+    }
+
+    // Bucket 0 holds one key (or everything after a fall-back); serve the
+    // smallest exact distance.
+    auto& b = buckets[0];
+    pop_heap(b.begin(), b.end(), farther);
+    Entry e = b.back();
+    b.pop_back();
+    --count;
+    return {e.dist, e.node};
+}
+
+bool RadixFrontier::empty() const {
+    return count == 0;
+}
+
+void RadixFrontier::clear() {
+    for (auto& b : buckets) b.clear();
+    last = 0;
+    count = 0;
+    exact = false;
+}
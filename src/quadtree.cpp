@@ -1,7 +1,23 @@
 #include "../include/quadtree.hpp"
+#include "../include/spatial_kernels.hpp"
 #include <cmath>
 #include <limits>
 #include <iostream>
+#include <algorithm>
+
+namespace {
+
+inline double item_x(Location* loc, Vehicle* veh) { return veh ? veh->current_x : loc->x; }
+inline double item_y(Location* loc, Vehicle* veh) { return veh ? veh->current_y : loc->y; }
+
+// Squared distance from (x, y) to the node's box; 0 when inside.
+inline double box_dist2(const QuadNode* node, double x, double y) {
+    double dx = max({node->min_x - x, 0.0, x - node->max_x});
+    double dy = max({node->min_y - y, 0.0, y - node->max_y});
+    return dx*dx + dy*dy;
+}
+
+}
 
 QuadNode::QuadNode(double mx, double my, double Mx, double My) 
     : min_x(mx), min_y(my), max_x(Mx), max_y(My) {}
@@ -10,6 +26,21 @@ bool QuadNode::contains(double px, double py) const {
     return px >= min_x && px <= max_x && py >= min_y && py <= max_y;
 }
 
+void QuadNode::add(Location* loc, Vehicle* veh, double px, double py) {
+    items.emplace_back(loc, veh);
+    xs.push_back(px);
+    ys.push_back(py);
+}
+
+void QuadNode::erase_at(size_t i) {
+    items[i] = items.back();
+    xs[i] = xs.back();
+    ys[i] = ys.back();
+    items.pop_back();
+    xs.pop_back();
+    ys.pop_back();
+}
+
 QuadTree::QuadTree(double minx, double miny, double maxx, double maxy) {
     root = make_unique<QuadNode>(minx, miny, maxx, maxy);
 }
@@ -28,37 +59,47 @@ void QuadTree::subdivide(QuadNode* node) {
     node->children[1] = make_unique<QuadNode>(mid_x, mid_y, node->max_x, node->max_y);
     node->children[2] = make_unique<QuadNode>(node->min_x, node->min_y, mid_x, mid_y);
     node->children[3] = make_unique<QuadNode>(mid_x, node->min_y, node->max_x, mid_y);
+    for (auto& child : node->children) child->parent = node;
 
     auto temp = move(node->items);
     node->items.clear();
+    node->xs.clear();
+    node->ys.clear();
 
     for (auto& item : temp) {
         bool placed = false;
         for (int i = 0; i < 4; ++i) {
-            if (node->children[i]->contains(item.first->x, item.first->y)) {
+            if (node->children[i]->contains(item_x(item.first, item.second), item_y(item.first, item.second))) {
                 insert(node->children[i].get(), item.first, item.second);
                 placed = true;
                 break;
             }
         }
-        if (!placed) node->items.push_back(item);
+        if (!placed) place(node, item.first, item.second);
     }
 }
 
+void QuadTree::place(QuadNode* node, Location* loc, Vehicle* veh) {
+    node->add(loc, veh, item_x(loc, veh), item_y(loc, veh));
+    if (veh) vehicle_node[veh->id] = node;
+}
+
 void QuadTree::insert(QuadNode* node, Location* loc, Vehicle* veh) {
     if (!node || !loc) return;
-    if (!node->contains(loc->x, loc->y)) return;
+    double px = item_x(loc, veh);
+    double py = item_y(loc, veh);
+    if (!node->contains(px, py)) return;
 
     if (node->children[0]) {
         for (int i = 0; i < 4; ++i) {
-            if (node->children[i]->contains(loc->x, loc->y)) {
+            if (node->children[i]->contains(px, py)) {
                 insert(node->children[i].get(), loc, veh);
                 return;
             }
         }
-        node->items.emplace_back(loc, veh);
+        place(node, loc, veh);
     } else {
-        node->items.emplace_back(loc, veh);
+        place(node, loc, veh);
         if (node->items.size() > static_cast<size_t>(QuadNode::CAPACITY)) {
             subdivide(node);
         }
@@ -70,53 +111,202 @@ void QuadTree::insert_location(Location* loc) {
 }
 
 void QuadTree::insert_vehicle(Vehicle* veh) {
-    insert(root.get(), &veh->current_pos, veh);
+    if (!veh) return;
+    detach(veh->id);
+    if (root->contains(veh->current_x, veh->current_y)) {
+        insert(root.get(), &veh->current_pos, veh);
+    } else {
+        place(root.get(), &veh->current_pos, veh);
+    }
+}
+
+bool QuadTree::detach(int veh_id) {
+    auto it = vehicle_node.find(veh_id);
+    if (it == vehicle_node.end()) return false;
+    QuadNode* node = it->second;
+    auto pos = find_if(node->items.begin(), node->items.end(), [&](const auto& item) {
+        return item.second && item.second->id == veh_id;
+    });
+    if (pos != node->items.end()) node->erase_at(pos - node->items.begin());
+    vehicle_node.erase(it);
+    return true;
+}
+
+void QuadTree::merge_up(QuadNode* node) {
+    while (node && node->children[0]) {
+        size_t total = node->items.size();
+        for (auto& child : node->children) {
+            if (child->children[0]) return;
+            total += child->items.size();
+        }
+        if (total > static_cast<size_t>(QuadNode::CAPACITY)) return;
+
+        for (auto& child : node->children) {
+            for (auto& item : child->items) place(node, item.first, item.second);
+            child.reset();
+        }
+        node = node->parent;
+    }
+}
+
+bool QuadTree::remove_vehicle(int veh_id) {
+    auto it = vehicle_node.find(veh_id);
+    if (it == vehicle_node.end()) return false;
+    QuadNode* node = it->second;
+    detach(veh_id);
+    merge_up(node->children[0] ? node : node->parent);
+    return true;
 }
 
 void QuadTree::update_vehicle_position(int veh_id, double new_x, double new_y) {
+    auto it = vehicle_node.find(veh_id);
+    if (it == vehicle_node.end()) return;
+    QuadNode* node = it->second;
+    auto& items = node->items;
+    auto pos = find_if(items.begin(), items.end(), [&](const auto& item) {
+        return item.second && item.second->id == veh_id;
+    });
+    if (pos == items.end()) return;
+
+    size_t idx = pos - items.begin();
+    Location* loc = pos->first;
+    Vehicle* veh = pos->second;
+    veh->current_x = new_x;
+    veh->current_y = new_y;
+    node->xs[idx] = new_x;
+    node->ys[idx] = new_y;
+
+    bool stays = node->contains(new_x, new_y);
+    if (stays && node->children[0]) {
+        for (auto& child : node->children) {
+            if (child->contains(new_x, new_y)) stays = false;
+        }
+    }
+    if (stays) return;
+
+    node->erase_at(idx);
+    vehicle_node.erase(it);
+
+    QuadNode* target = node;
+    while (target && !target->contains(new_x, new_y)) target = target->parent;
+    if (target) {
+        insert(target, loc, veh);
+    } else {
+        place(root.get(), loc, veh);
+    }
+    merge_up(node->children[0] ? node : node->parent);
 }
 
 vector<pair<Location*, Vehicle*>> QuadTree::query_radius(double x, double y, double radius) const {
     vector<pair<Location*, Vehicle*>> result;
-    query(root.get(), x, y, radius, result);
+    vector<uint32_t> hits;
+    query(root.get(), x, y, radius, result, hits);
     return result;
 }
 
 void QuadTree::query(QuadNode* node, double x, double y, double radius,
-                     vector<pair<Location*, Vehicle*>>& result) const {
+                     vector<pair<Location*, Vehicle*>>& result, vector<uint32_t>& hits) const {
     if (!node) return;
 
-    for (const auto& item : node->items) {
-        double dx = item.first->x - x;
-        double dy = item.first->y - y;
-        if (dx*dx + dy*dy <= radius*radius) {
-            result.push_back(item);
-        }
+    size_t n = node->items.size();
+    if (n > 0) {
+        if (hits.size() < n) hits.resize(n);
+        size_t found = within_kernel(node->xs.data(), node->ys.data(), n, x, y, radius*radius, hits.data());
+        for (size_t k = 0; k < found; ++k) result.push_back(node->items[hits[k]]);
     }
 
     if (node->children[0]) {
         for (int i = 0; i < 4; ++i) {
-            query(node->children[i].get(), x, y, radius, result);
+            if (box_dist2(node->children[i].get(), x, y) <= radius*radius) {
+                query(node->children[i].get(), x, y, radius, result, hits);
+            }
         }
     }
 }
 
 pair<Location*, Vehicle*> QuadTree::find_nearest_vehicle(double x, double y) const {
-    pair<Location*, Vehicle*> best = {nullptr, nullptr};
-    double best_dist = numeric_limits<double>::infinity();
-
-    vector<pair<Location*, Vehicle*>> candidates = query_radius(x, y, 100000.0);
-
-    for (const auto& [loc, veh] : candidates) {
-        if (!veh || !veh->available) continue;
-        double dx = veh->current_x - x;
-        double dy = veh->current_y - y;
-        double dist = dx*dx + dy*dy;
-        if (dist < best_dist) {
-            best_dist = dist;
-            best = {loc, veh};
+    auto found = k_nearest(x, y, 1, [](const Location*, const Vehicle* veh) {
+        return veh && veh->available;
+    });
+    if (found.empty()) return {nullptr, nullptr};
+    return found[0];
+}
+
+vector<QuadTree::Item> QuadTree::k_nearest(double x, double y, size_t k, const ItemFilter& filter) const {
+    vector<Item> result;
+    NearestScratch scratch;
+    nearest(x, y, k, filter, result, scratch);
+    return result;
+}
+
+// Best-first search: nodes are keyed by the distance to their box and items
+// by their own distance in one min-heap, so an item popped before any
+// remaining node is closer than everything not yet expanded.
+void QuadTree::nearest(double x, double y, size_t k, const ItemFilter& filter,
+                       vector<Item>& result, NearestScratch& scratch) const {
+    result.clear();
+    if (k == 0 || !root) return;
+
+    auto later = [](const NearestEntry& a, const NearestEntry& b) { return a.dist > b.dist; };
+    auto& heap = scratch.heap;
+    auto& dist = scratch.dist;
+    heap.clear();
+    heap.push_back({box_dist2(root.get(), x, y), root.get(), {nullptr, nullptr}});
+
+    while (!heap.empty() && result.size() < k) {
+        pop_heap(heap.begin(), heap.end(), later);
+        NearestEntry e = heap.back();
+        heap.pop_back();
+
+        if (!e.node) {
+            result.push_back(e.item);
+            continue;
+        }
+
+        size_t n = e.node->items.size();
+        if (n > 0) {
+            if (dist.size() < n) dist.resize(n);
+            dist2_kernel(e.node->xs.data(), e.node->ys.data(), n, x, y, dist.data());
+            for (size_t i = 0; i < n; ++i) {
+                const Item& item = e.node->items[i];
+                if (filter && !filter(item.first, item.second)) continue;
+                heap.push_back({dist[i], nullptr, item});
+                push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+        if (e.node->children[0]) {
+            for (const auto& child : e.node->children) {
+                heap.push_back({box_dist2(child.get(), x, y), child.get(), {nullptr, nullptr}});
+                push_heap(heap.begin(), heap.end(), later);
+            }
         }
     }
+}
+
+void QuadTree::k_nearest_batch(const double* qx, const double* qy, size_t m, size_t k, const BatchFilter& filter,
+                               vector<size_t>& offsets, vector<Item>& out) const {
+    offsets.resize(m + 1);
+    out.clear();
+    vector<Item> found;
+    NearestScratch scratch;
+    for (size_t i = 0; i < m; ++i) {
+        offsets[i] = out.size();
+        ItemFilter one;
+        if (filter) one = [&filter, i](const Location* loc, const Vehicle* veh) { return filter(i, loc, veh); };
+        nearest(qx[i], qy[i], k, one, found, scratch);
+        out.insert(out.end(), found.begin(), found.end());
+    }
+    offsets[m] = out.size();
+}
 
-    return best;
-}
\ No newline at end of file
+void QuadTree::query_radius_batch(const double* qx, const double* qy, size_t m, double radius,
+                                  vector<size_t>& offsets, vector<Item>& out) const {
+    offsets.resize(m + 1);
+    out.clear();
+    vector<uint32_t> hits;
+    for (size_t i = 0; i < m; ++i) {
+        offsets[i] = out.size();
+        query(root.get(), qx[i], qy[i], radius, out, hits);
+    }
+    offsets[m] = out.size();
+}
@@ -1,104 +1,501 @@
 #include "../include/road_network.hpp"
+#include "../include/point_to_point.hpp"
+#include "../include/contraction_hierarchy.hpp"
+#include "../include/dynamic_sssp.hpp"
+#include "../include/parallel_sssp.hpp"
+#include "../include/priority_queue.hpp"
+#include <algorithm>
 #include <functional>
+#include <stack>
+#include <stdexcept>
+
+RoadNetwork::RoadNetwork() = default;
+
+RoadNetwork::~RoadNetwork() = default;
+
+void RoadNetwork::reserve(size_t nodes) {
+    adj.reserve(nodes);
+}
+
+// The adopted graph becomes the frozen view as is. Adjacency lists and the
+// position table are only rebuilt from it once something needs them.
+void RoadNetwork::adopt(CsrGraph g) {
+    unsigned long next_generation = frozen.generation + 1;
+    frozen = move(g);
+    frozen.generation = next_generation;
+    frozen_dirty = false;
+    adj.clear();
+    positions.clear();
+    adj_stale = true;
+    ++epoch;
+    change_log.clear();
+    paths.clear();
+    timed_dirty = true;
+}
+
+void RoadNetwork::thaw() const {
+    if (!adj_stale) return;
+    for (size_t u = 0; u < frozen.num_nodes(); ++u) {
+        if (frozen.offsets[u] == frozen.offsets[u + 1]) continue;
+        auto& edges = adj[frozen.node_ids[u]];
+        edges.reserve(frozen.offsets[u + 1] - frozen.offsets[u]);
+        for (size_t k = frozen.offsets[u]; k < frozen.offsets[u + 1]; ++k) {
+            edges.push_back({frozen.node_ids[frozen.targets[k]], frozen.weights[k], frozen.base_weights[k]});
+        }
+    }
+    for (size_t u = 0; u < frozen.num_nodes(); ++u) {
+        if (frozen.has_position(static_cast<int>(u))) {
+            positions.emplace(frozen.node_ids[u], make_pair(frozen.xs[u], frozen.ys[u]));
+        }
+    }
+    adj_stale = false;
+}
 
 void RoadNetwork::add_edge(int from, int to, double weight) {
+    thaw();
     adj[from].push_back({to, weight, weight});
+    frozen_dirty = true;
+    ++epoch;
+    invalidate_shortcut(from, to, weight);
 }
 
 void RoadNetwork::update_edge_weight(int from, int to, double new_weight) {
-    for (auto& e : adj[from]) {
+    thaw();
+    auto it = adj.find(from);
+    if (it == adj.end()) return;
+    for (auto& e : it->second) {
         if (e.to == to) {
+            if (e.weight == new_weight) return;
+            double old_weight = e.weight;
             e.weight = new_weight;
+            ++epoch;
+            log_change({from, to, old_weight, new_weight, epoch});
+            if (!frozen_dirty) {
+                long slot = frozen.find_edge(frozen.index_of(from), frozen.index_of(to));
+                if (slot >= 0) frozen.weights[slot] = new_weight;
+            }
+            if (new_weight > old_weight) {
+                paths.invalidate_edge(from, to);
+            } else {
+                invalidate_shortcut(from, to, new_weight);
+            }
             return;
         }
     }
 }
 
+// Applies the whole batch as one traffic step: every change is logged under
+// a single new epoch, so dependent indices re-customize once. Past
+// SHORTCUT_LIMIT cheaper edges the bounded invalidation searches cost more
+// than refilling the path cache, so it is flushed instead.
+size_t RoadNetwork::update_edge_weights(const vector<EdgeUpdate>& updates) {
+    thaw();
+    vector<EdgeChange> changed;
+    for (const auto& u : updates) {
+        auto it = adj.find(u.from);
+        if (it == adj.end()) continue;
+        for (auto& e : it->second) {
+            if (e.to != u.to) continue;
+            if (e.weight != u.weight) {
+                changed.push_back({u.from, u.to, e.weight, u.weight, 0});
+                e.weight = u.weight;
+            }
+            break;
+        }
+    }
+    if (changed.empty()) return 0;
+
+    ++epoch;
+    size_t cheaper = 0;
+    for (auto& c : changed) {
+        c.epoch = epoch;
+        log_change(c);
+        if (!frozen_dirty) {
+            long slot = frozen.find_edge(frozen.index_of(c.from), frozen.index_of(c.to));
+            if (slot >= 0) frozen.weights[slot] = c.new_weight;
+        }
+        if (c.new_weight < c.old_weight) ++cheaper;
+    }
+    if (cheaper > SHORTCUT_LIMIT) {
+        paths.clear();
+    } else {
+        for (const auto& c : changed) {
+            if (c.new_weight > c.old_weight) {
+                paths.invalidate_edge(c.from, c.to);
+            } else {
+                invalidate_shortcut(c.from, c.to, c.new_weight);
+            }
+        }
+    }
+    return changed.size();
+}
+
+// A batch shares one epoch, so trimming can split an epoch; trimmed_epoch
+// lets changes_since() refuse a window that lost part of one.
+void RoadNetwork::log_change(const EdgeChange& change) {
+    change_log.push_back(change);
+    while (change_log.size() > CHANGE_LOG_LIMIT) {
+        trimmed_epoch = max(trimmed_epoch, change_log.front().epoch);
+        change_log.pop_front();
+    }
+}
+
 bool RoadNetwork::remove_edge(int from, int to) {
-    auto& edges = adj[from];
+    thaw();
+    auto adj_it = adj.find(from);
+    if (adj_it == adj.end()) return false;
+    auto& edges = adj_it->second;
     for (auto it = edges.begin(); it != edges.end(); ++it) {
         if (it->to == to) {
             edges.erase(it);
+            frozen_dirty = true;
+            ++epoch;
+            paths.invalidate_edge(from, to);
             return true;
         }
     }
     return false;
 }
 
-vector<int> RoadNetwork::dijkstra(int start, int goal) const {
-    using P = pair<double, int>;
-    priority_queue<P, vector<P>, greater<P>> pq;
-    unordered_map<int, double> dist;
-    unordered_map<int, int> prev;
+// Positions only reach the frozen view for graph nodes, so a position that
+// is unchanged or belongs to no node leaves it clean.
+void RoadNetwork::set_node_position(int id, double x, double y) {
+    positions[id] = {x, y};
+    if (frozen_dirty) return;
+    int idx = frozen.index_of(id);
+    if (idx < 0 || (frozen.xs[idx] == x && frozen.ys[idx] == y)) return;
+    frozen_dirty = true;
+}
 
-    dist[start] = 0.0;
-    pq.push({0.0, start});
+void RoadNetwork::set_routing_mode(RoutingMode m) {
+    mode = m;
+    if (p2p) {
+        p2p->set_mode(mode == RoutingMode::Landmarks ? HeuristicMode::Landmarks : HeuristicMode::Euclidean);
+    }
+}
 
-    while (!pq.empty()) {
-        auto [cost, u] = pq.top(); 
-        pq.pop();
+RoutingMode RoadNetwork::routing_mode() const {
+    return mode;
+}
 
-        if (cost > dist[u]) continue;
+PointToPointRouter& RoadNetwork::router() const {
+    if (!p2p) {
+        p2p = make_unique<PointToPointRouter>(*this);
+        p2p->set_mode(mode == RoutingMode::Landmarks ? HeuristicMode::Landmarks : HeuristicMode::Euclidean);
+    }
+    return *p2p;
+}
 
-        if (u == goal) break;
+ContractionHierarchy& RoadNetwork::hierarchy() const {
+    if (!cch) cch = make_unique<ContractionHierarchy>(*this);
+    return *cch;
+}
 
-        auto it = adj.find(u);
-        if (it == adj.end()) continue;
+DynamicSSSP& RoadNetwork::hubs() const {
+    if (!hub_trees) hub_trees = make_unique<DynamicSSSP>(*this);
+    return *hub_trees;
+}
+
+void RoadNetwork::add_hub(int id) {
+    hubs().add_hub(id);
+}
+
+const CsrGraph& RoadNetwork::csr() const {
+    if (frozen_dirty) {
+        thaw();
+        frozen.build(adj, positions);
+        frozen_dirty = false;
+        timed_dirty = true;
+    }
+    return frozen;
+}
+
+// Each edge keeps its SAMPLE_LIMIT latest samples by time, so a long-running
+// feed does not grow the profiles without bound.
+void RoadNetwork::add_traffic_sample(int from, int to, TimePoint at, double weight) {
+    auto& points = traffic_samples[TravelTimeTable::edge_key(from, to)];
+    points.push_back({TravelTimeTable::seconds(at), weight});
+    if (points.size() > SAMPLE_LIMIT) {
+        points.erase(min_element(points.begin(), points.end(),
+                                 [](const auto& a, const auto& b) { return a.first < b.first; }));
+    }
+    timed_dirty = true;
+}
+
+void RoadNetwork::set_time_unit(double seconds) {
+    if (seconds <= 0.0) throw invalid_argument("Time unit must be positive");
+    time_unit = seconds;
+    timed_dirty = true;
+}
 
-        for (const auto& e : it->second) {
-            double alt = cost + e.weight;
+const TravelTimeTable& RoadNetwork::travel_times() const {
+    const CsrGraph& g = csr();
+    if (timed_dirty) {
+        timed.build(g, traffic_samples, time_unit);
+        timed_dirty = false;
+    }
+    return timed;
+}
 
-            auto dist_it = dist.find(e.to);
-            double current_dist = (dist_it == dist.end()) 
-                                ? numeric_limits<double>::infinity() 
-                                : dist_it->second;
+double RoadNetwork::edge_weight_at(int from, int to, TimePoint at) const {
+    const TravelTimeTable& table = travel_times();
+    const CsrGraph& g = csr();
+    long slot = g.find_edge(g.index_of(from), g.index_of(to));
+    if (slot < 0) return numeric_limits<double>::infinity();
+    return table.evaluate(static_cast<size_t>(slot), TravelTimeTable::seconds(at), g.weights[slot]);
+}
 
-            if (alt < current_dist) {
-                dist[e.to] = alt;
-                prev[e.to] = u;
-                pq.push({alt, e.to});
+// Label-setting search on arrival time: each edge is priced at the moment
+// the search reaches its tail. FIFO profiles keep this exact.
+TimedPath RoadNetwork::dijkstra_at(int start, int goal, TimePoint depart) const {
+    TimedPath result{{}, depart, depart};
+    if (start == goal) {
+        result.path = {start};
+        return result;
+    }
+    const TravelTimeTable& table = travel_times();
+    const CsrGraph& g = csr();
+    int s = g.index_of(start);
+    int t = g.index_of(goal);
+    if (s < 0 || t < 0) return result;
+
+    double t0 = TravelTimeTable::seconds(depart);
+    double unit = table.unit_seconds();
+    RadixFrontier pq(g.num_nodes());
+    vector<double> dist(g.num_nodes(), numeric_limits<double>::infinity());
+    vector<int> prev(g.num_nodes(), -1);
+    dist[s] = 0.0;
+    pq.push(s, 0.0);
+
+    while (!pq.empty()) {
+        auto [cost, u] = pq.pop();
+        if (cost > dist[u]) continue;
+        if (u == t) break;
+        double now = t0 + cost * unit;
+        for (size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+            int v = g.targets[k];
+            double alt = cost + table.evaluate(k, now, g.weights[k]);
+            if (alt < dist[v]) {
+                dist[v] = alt;
+                prev[v] = u;
+                pq.push(v, alt);
             }
         }
     }
+    if (dist[t] == numeric_limits<double>::infinity()) return result;
 
-    vector<int> path;
-    if (prev.find(goal) == prev.end() && start != goal) {
-        return {};
+    for (int at = t; at != -1; at = prev[at]) result.path.push_back(g.id_of(at));
+    reverse(result.path.begin(), result.path.end());
+    result.arrival = depart + chrono::duration_cast<chrono::system_clock::duration>(
+        chrono::duration<double>(dist[t] * unit));
+    return result;
+}
+
+// Arrival time at each of `stops` when leaving the first at `depart`, each
+// leg routed with the traffic expected when it starts. Stops after an
+// unreachable leg are left out.
+vector<TimePoint> RoadNetwork::arrivals_at(const vector<int>& stops, TimePoint depart) const {
+    vector<TimePoint> arrivals;
+    if (stops.empty()) return arrivals;
+    TimePoint now = depart;
+    arrivals.push_back(now);
+    for (size_t i = 0; i + 1 < stops.size(); ++i) {
+        TimedPath leg = dijkstra_at(stops[i], stops[i + 1], now);
+        if (leg.path.empty()) break;
+        now = leg.arrival;
+        arrivals.push_back(now);
     }
+    return arrivals;
+}
+
+unsigned long RoadNetwork::traffic_epoch() const {
+    return epoch;
+}
+
+bool RoadNetwork::changes_since(unsigned long since, vector<EdgeChange>& out) const {
+    if (since == epoch) return true;
+    if (change_log.empty() || change_log.front().epoch > since + 1 || trimmed_epoch > since) return false;
+    for (const auto& c : change_log) {
+        if (c.epoch > since) out.push_back(c);
+    }
+    return true;
+}
+
+// A dearer or removed edge only affects the cached paths through it. A
+// cheaper or new edge (from, to) can also shorten paths that avoid it: an
+// entry is stale when d(start, from) + weight + d(to, goal) beats its cost.
+// Both distances come from one backward and one forward search, bounded by
+// the most expensive finite cached result. Unreachable entries may have been
+// connected by the edge, which bounded searches cannot rule out, so they are
+// always dropped.
+void RoadNetwork::invalidate_shortcut(int from, int to, double weight) {
+    if (paths.size() == 0) return;
+    paths.invalidate_edge(from, to);
+    auto unreachable = [](int, int, const PathCache::Result& r) {
+        return r.cost == numeric_limits<double>::infinity();
+    };
+    double limit = paths.max_cost() - weight;
+
+    const CsrGraph& g = csr();
+    int u = g.index_of(from);
+    int v = g.index_of(to);
+    if (limit < 0.0 || u < 0 || v < 0) {
+        paths.invalidate_if(unreachable);
+        return;
+    }
+    size_t n = g.num_nodes();
+
+    auto bounded = [&](int source, bool backward) {
+        vector<double> dist(n, numeric_limits<double>::infinity());
+        RadixFrontier pq(n);
+        dist[source] = 0.0;
+        pq.push(source, 0.0);
+        while (!pq.empty()) {
+            auto [cost, x] = pq.pop();
+            if (cost > dist[x]) continue;
+            if (cost > limit) break;
+            size_t begin = backward ? g.rev_offsets[x] : g.offsets[x];
+            size_t end = backward ? g.rev_offsets[x + 1] : g.offsets[x + 1];
+            for (size_t k = begin; k < end; ++k) {
+                int y = backward ? g.rev_sources[k] : g.targets[k];
+                double alt = cost + (backward ? g.weights[g.rev_slots[k]] : g.weights[k]);
+                if (alt < dist[y]) {
+                    dist[y] = alt;
+                    pq.push(y, alt);
+                }
+            }
+        }
+        return dist;
+    };
+    vector<double> to_from = bounded(u, true);
+    vector<double> from_to = bounded(v, false);
+
+    paths.invalidate_if([&](int start, int goal, const PathCache::Result& r) {
+        if (unreachable(start, goal, r)) return true;
+        int s = g.index_of(start);
+        int t = g.index_of(goal);
+        if (s < 0 || t < 0) return false;
+        return to_from[s] + weight + from_to[t] < r.cost;
+    });
+}
+
+PathCache& RoadNetwork::path_cache() const {
+    return paths;
+}
+
+vector<int> RoadNetwork::dijkstra(int start, int goal) const {
+    if (start == goal) return {start};
+    return cached_route(start, goal).path;
+}
+
+double RoadNetwork::shortest_distance(int start, int goal) const {
+    if (start == goal) return 0.0;
+    return cached_route(start, goal).cost;
+}
+
+PathCache::Result RoadNetwork::cached_route(int start, int goal) const {
+    PathCache::Result result;
+    if (paths.lookup(start, goal, result)) return result;
+    result.epoch = epoch;
+    result.path = search_path(start, goal);
+    result.cost = path_weight(result.path);
+    paths.store(start, goal, result);
+    return result;
+}
+
+double RoadNetwork::path_weight(const vector<int>& path) const {
+    if (path.empty()) return numeric_limits<double>::infinity();
+    const CsrGraph& g = csr();
+    double total = 0.0;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        double best = numeric_limits<double>::infinity();
+        int u = g.index_of(path[i]);
+        int v = g.index_of(path[i + 1]);
+        if (u >= 0 && v >= 0) {
+            for (size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+                if (g.targets[k] == v) best = min(best, g.weights[k]);
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+vector<int> RoadNetwork::search_path(int start, int goal) const {
+    if (hub_trees && hub_trees->is_hub(start)) return hub_trees->path(start, goal);
+    if (mode == RoutingMode::ContractionHierarchy) return hierarchy().shortest_path(start, goal);
+    if (mode != RoutingMode::Dijkstra) return router().shortest_path(start, goal);
 
-    for (int at = goal; at != start; at = prev[at]) {
-        path.push_back(at);
-        if (prev.find(at) == prev.end()) {
-            return {};
+    return dijkstra_search(start, goal);
+}
+
+template<typename Frontier>
+vector<int> RoadNetwork::dijkstra_search(int start, int goal) const {
+    if (start == goal) return {start};
+    const CsrGraph& g = csr();
+    int s = g.index_of(start);
+    int t = g.index_of(goal);
+    if (s < 0 || t < 0) return {};
+
+    Frontier pq(g.num_nodes());
+    vector<double> dist(g.num_nodes(), numeric_limits<double>::infinity());
+    vector<int> prev(g.num_nodes(), -1);
+
+    dist[s] = 0.0;
+    pq.push(s, 0.0);
+
+    while (!pq.empty()) {
+        auto [cost, u] = pq.pop();
+
+        if (cost > dist[u]) continue;
+
+        if (u == t) break;
+
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            double alt = cost + g.weights[i];
+            if (alt < dist[v]) {
+                dist[v] = alt;
+                prev[v] = u;
+                pq.push(v, alt);
+            }
         }
     }
+
+    if (prev[t] < 0) return {};
+
+    vector<int> path;
+    for (int at = t; at != s; at = prev[at]) {
+        path.push_back(g.id_of(at));
+    }
     path.push_back(start);
     reverse(path.begin(), path.end());
     return path;
 }
 
-vector<double> RoadNetwork::bellman_ford(int start) const {
-    unordered_map<int, double> dist;
+template vector<int> RoadNetwork::dijkstra_search<HeapFrontier>(int, int) const;
+template vector<int> RoadNetwork::dijkstra_search<RadixFrontier>(int, int) const;
 
-    for (const auto& [u, _] : adj) {
-        dist[u] = numeric_limits<double>::infinity();
+vector<double> RoadNetwork::bellman_ford(int start) const {
+    const CsrGraph& g = csr();
+    if (all_of(g.weights.begin(), g.weights.end(), [](double w) { return w >= 0.0; })) {
+        return ParallelSSSP(*this).run(start);
     }
 
-    for (const auto& [u, edges] : adj) {
-        for (const auto& e : edges) {
-            dist[e.to];
-        }
-    }
+    size_t n = g.num_nodes();
+    vector<double> dist(n, numeric_limits<double>::infinity());
 
-    dist[start] = 0.0;
+    int s = g.index_of(start);
+    if (s < 0) return dist;
+    dist[s] = 0.0;
 
-    for (size_t i = 0; i < dist.size() - 1; ++i) {
+    for (size_t i = 0; i + 1 < n; ++i) {
         bool changed = false;
-        for (const auto& [u, edges] : adj) {
+        for (size_t u = 0; u < n; ++u) {
             if (dist[u] == numeric_limits<double>::infinity()) continue;
-            for (const auto& e : edges) {
-                if (dist[u] + e.weight < dist[e.to]) {
-                    dist[e.to] = dist[u] + e.weight;
+            for (size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+                if (dist[u] + g.weights[k] < dist[g.targets[k]]) {
+                    dist[g.targets[k]] = dist[u] + g.weights[k];
                     changed = true;
                 }
             }
@@ -106,93 +503,123 @@ vector<double> RoadNetwork::bellman_ford(int start) const {
         if (!changed) break;
     }
 
-    vector<double> result;
-    result.reserve(dist.size());
-    for (const auto& [node, d] : dist) {
-        result.push_back(d);
+    return dist;
+}
+
+vector<vector<double>> RoadNetwork::bellman_ford_batch(const vector<int>& sources) const {
+    const CsrGraph& g = csr();
+    if (all_of(g.weights.begin(), g.weights.end(), [](double w) { return w >= 0.0; })) {
+        return ParallelSSSP(*this).run_batch(sources);
     }
 
-    return result;
+    vector<vector<double>> results;
+    results.reserve(sources.size());
+    for (int s : sources) results.push_back(bellman_ford(s));
+    return results;
 }
 
 void RoadNetwork::bfs(int start, unordered_set<int>& visited) const {
-    queue<int> q;
-    q.push(start);
     visited.insert(start);
 
-    while (!q.empty()) {
-        int u = q.front(); q.pop();
-        auto it = adj.find(u);
-        if (it == adj.end()) continue;
-        for (const auto& e : it->second) {
-            if (!visited.count(e.to)) {
-                visited.insert(e.to);
-                q.push(e.to);
+    const CsrGraph& g = csr();
+    int s = g.index_of(start);
+    if (s < 0) return;
+
+    vector<char> seen(g.num_nodes(), 0);
+    vector<int> q;
+    q.push_back(s);
+    seen[s] = 1;
+
+    for (size_t head = 0; head < q.size(); ++head) {
+        int u = q[head];
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            int v = g.targets[i];
+            if (!seen[v]) {
+                seen[v] = 1;
+                q.push_back(v);
             }
         }
     }
+
+    for (int u : q) visited.insert(g.id_of(u));
 }
 
 void RoadNetwork::dfs(int node, vector<bool>& visited) const {
-    visited[node] = true;
-    for (const auto& e : adj.at(node)) {
-        if (!visited[e.to]) {
-            dfs(e.to, visited);
+    const CsrGraph& g = csr();
+    stack<int> st;
+    st.push(node);
+
+    while (!st.empty()) {
+        int id = st.top();
+        st.pop();
+        if (visited[id]) continue;
+        visited[id] = true;
+
+        int u = g.index_of(id);
+        if (u < 0) continue;
+        for (size_t i = g.offsets[u + 1]; i-- > g.offsets[u];) {
+            int next = g.id_of(g.targets[i]);
+            if (!visited[next]) st.push(next);
         }
     }
 }
 
 vector<pair<int, int>> RoadNetwork::kruskal_mst() const {
+    const CsrGraph& g = csr();
     vector<tuple<double, int, int>> edges;
-    for (const auto& [u, es] : adj) {
-        for (const auto& e : es) {
-            edges.emplace_back(e.weight, u, e.to);
+    edges.reserve(g.num_edges());
+    for (size_t u = 0; u < g.num_nodes(); ++u) {
+        for (size_t i = g.offsets[u]; i < g.offsets[u + 1]; ++i) {
+            edges.emplace_back(g.weights[i], static_cast<int>(u), g.targets[i]);
         }
     }
     sort(edges.begin(), edges.end());
     vector<pair<int, int>> mst;
-    unordered_map<int, int> parent;
-    for (const auto& [u, _] : adj) parent[u] = u;
-    auto find = [&](auto& self, int x) -> int {
-        return parent[x] == x ? x : parent[x] = self(self, parent[x]);
+    vector<int> parent(g.num_nodes());
+    for (size_t u = 0; u < parent.size(); ++u) parent[u] = static_cast<int>(u);
+    auto find = [&](int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
     };
     for (const auto& [w, u, v] : edges) {
-        int pu = find(find, u), pv = find(find, v);
+        int pu = find(u), pv = find(v);
         if (pu != pv) {
             parent[pu] = pv;
-            mst.emplace_back(u, v);
+            mst.emplace_back(g.id_of(u), g.id_of(v));
         }
     }
     return mst;
 }
 
 vector<int> RoadNetwork::topological_sort() const {
+    const CsrGraph& g = csr();
+    size_t n = g.num_nodes();
     vector<int> order;
-    unordered_map<int, bool> visited;
-    unordered_map<int, bool> rec_stack;
-
-    function<void(int)> dfs_visit = [&](int node) {
-        visited[node] = true;
-        rec_stack[node] = true;
-
-        auto it = adj.find(node);
-        if (it != adj.end()) {
-            for (const auto& e : it->second) {
-                if (!visited[e.to]) {
-                    dfs_visit(e.to);
-                } else if (rec_stack[e.to]) {
+    order.reserve(n);
+    vector<char> visited(n, 0);
+    vector<pair<int, size_t>> st;
+
+    for (size_t root = 0; root < n; ++root) {
+        if (visited[root]) continue;
+        visited[root] = 1;
+        st.emplace_back(static_cast<int>(root), g.offsets[root]);
+
+        while (!st.empty()) {
+            auto& [u, next] = st.back();
+            if (next < g.offsets[u + 1]) {
+                int v = g.targets[next++];
+                if (!visited[v]) {
+                    visited[v] = 1;
+                    st.emplace_back(v, g.offsets[v]);
                 }
+            } else {
+                order.push_back(g.id_of(u));
+                st.pop_back();
             }
         }
-
-        rec_stack[node] = false;
-        order.push_back(node);
-    };
-
-    for (const auto& [node, _] : adj) {
-        if (!visited[node]) {
-            dfs_visit(node);
-        }
     }
 
     reverse(order.begin(), order.end());
@@ -200,5 +627,6 @@ vector<int> RoadNetwork::topological_sort() const {
 }
 
 const unordered_map<int, vector<Edge>>& RoadNetwork::get_adj() const {
+    thaw();
     return adj;
-}
\ No newline at end of file
+}
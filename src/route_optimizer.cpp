@@ -1,8 +1,413 @@
 #include "../include/route_optimizer.hpp"
 #include <algorithm>
 #include <limits>
+#include <cmath>
 
-vector<int> greedy_route(const RoadNetwork& graph, int start, const std::vector<int>& destinations) {
+namespace {
+
+constexpr double INF = numeric_limits<double>::infinity();
+
+// Road costs from `source` to each of `stops`, or from each of them to
+// `source` when `backward`, by one Dijkstra over the CSR arrays that stops
+// as soon as every stop has been settled.
+vector<double> search_stops(const CsrGraph& g, int source, const vector<int>& stops, bool backward) {
+    vector<double> result(stops.size(), INF);
+    for (size_t k = 0; k < stops.size(); ++k) {
+        if (stops[k] == source) result[k] = 0.0;
+    }
+    int s = g.index_of(source);
+    if (s < 0) return result;
+
+    size_t n = g.num_nodes();
+    vector<double> dist(n, INF);
+    vector<char> wanted(n, 0);
+    size_t remaining = 0;
+    for (int id : stops) {
+        int t = g.index_of(id);
+        if (t >= 0 && !wanted[t]) {
+            wanted[t] = 1;
+            ++remaining;
+        }
+    }
+
+    RadixFrontier pq(n);
+    dist[s] = 0.0;
+    pq.push(s, 0.0);
+    while (!pq.empty() && remaining > 0) {
+        auto [cost, u] = pq.pop();
+        if (cost > dist[u]) continue;
+        if (wanted[u]) --remaining;
+
+        size_t begin = backward ? g.rev_offsets[u] : g.offsets[u];
+        size_t end = backward ? g.rev_offsets[u + 1] : g.offsets[u + 1];
+        for (size_t k = begin; k < end; ++k) {
+            int v = backward ? g.rev_sources[k] : g.targets[k];
+            double alt = cost + (backward ? g.weights[g.rev_slots[k]] : g.weights[k]);
+            if (alt < dist[v]) {
+                dist[v] = alt;
+                pq.push(v, alt);
+            }
+        }
+    }
+
+    for (size_t k = 0; k < stops.size(); ++k) {
+        int t = g.index_of(stops[k]);
+        if (t >= 0) result[k] = min(result[k], dist[t]);
+    }
+    return result;
+}
+
+}
+
+RoutePlan::RoutePlan(int start) : nodes{start}, costs{{0.0}}, order{0}, dont_look{1} {}
+
+bool RoutePlan::empty() const {
+    return nodes.empty();
+}
+
+int RoutePlan::start() const {
+    return nodes.empty() ? -1 : nodes[0];
+}
+
+size_t RoutePlan::size() const {
+    return order.size();
+}
+
+double RoutePlan::cost() const {
+    return total;
+}
+
+double RoutePlan::leg(size_t a, size_t b) const {
+    return costs[a][b];
+}
+
+// Position in `order` before which `stop` is cheapest to insert (order.size()
+// appends), with the added cost in `delta`; 0 when no position is reachable.
+size_t RoutePlan::cheapest_position(size_t stop, double& delta) const {
+    size_t best = 0;
+    delta = INF;
+    for (size_t p = 1; p <= order.size(); ++p) {
+        double in = leg(order[p - 1], stop);
+        if (isinf(in)) continue;
+        double d = in;
+        if (p < order.size()) {
+            double out = leg(stop, order[p]);
+            if (isinf(out)) continue;
+            d += out - leg(order[p - 1], order[p]);
+        }
+        if (d < delta) {
+            delta = d;
+            best = p;
+        }
+    }
+    return best;
+}
+
+bool RoutePlan::relocate(size_t at) {
+    size_t stop = order[at];
+    double saved = leg(order[at - 1], stop);
+    if (at + 1 < order.size()) {
+        double bridge = leg(order[at - 1], order[at + 1]);
+        if (isinf(bridge)) return false;
+        saved += leg(stop, order[at + 1]) - bridge;
+    }
+
+    order.erase(order.begin() + at);
+    double delta;
+    size_t p = cheapest_position(stop, delta);
+    if (p == 0 || delta >= saved - 1e-9) {
+        order.insert(order.begin() + at, stop);
+        return false;
+    }
+    order.insert(order.begin() + p, stop);
+    total += delta - saved;
+    return true;
+}
+
+// Re-prices every leg when traffic has changed since the table was built.
+// The visiting order is kept; every stop is woken so improve() re-examines
+// it against the new costs.
+bool RoutePlan::refresh(const RoadNetwork& graph) {
+    unsigned long now = graph.traffic_epoch();
+    if (now == epoch) return false;
+    epoch = now;
+    if (nodes.size() < 2) return false;
+
+    DistanceMatrix table = many_to_many(graph, nodes, nodes);
+    for (size_t a = 0; a < nodes.size(); ++a) {
+        for (size_t b = 0; b < nodes.size(); ++b) costs[a][b] = a == b ? 0.0 : table.between(nodes[a], nodes[b]);
+    }
+    near.clear();
+    fill(dont_look.begin(), dont_look.end(), 0);
+    total = recompute_total();
+    return true;
+}
+
+bool RoutePlan::insert(const RoadNetwork& graph, int stop, bool repair) {
+    if (nodes.empty()) return false;
+    refresh(graph);
+    const CsrGraph& g = graph.csr();
+    vector<double> from_stop = search_stops(g, stop, nodes, false);
+    vector<double> to_stop = search_stops(g, stop, nodes, true);
+
+    size_t idx = nodes.size();
+    nodes.push_back(stop);
+    for (size_t k = 0; k < idx; ++k) costs[k].push_back(to_stop[k]);
+    from_stop.push_back(0.0);
+    costs.push_back(move(from_stop));
+
+    double delta;
+    size_t p = cheapest_position(idx, delta);
+    if (p == 0) {
+        for (size_t k = 0; k < idx; ++k) costs[k].pop_back();
+        costs.pop_back();
+        nodes.pop_back();
+        return false;
+    }
+    order.insert(order.begin() + p, idx);
+    total += delta;
+    dont_look.push_back(0);
+    link_neighbours(idx);
+    wake(order[p - 1]);
+    if (p + 1 < order.size()) wake(order[p + 1]);
+
+    if (repair) {
+        size_t before = order[p - 1];
+        size_t after = p + 1 < order.size() ? order[p + 1] : idx;
+        for (size_t neighbour : {after, before}) {
+            if (neighbour == 0 || neighbour == idx) continue;
+            size_t at = find(order.begin(), order.end(), neighbour) - order.begin();
+            relocate(at);
+        }
+    }
+    return true;
+}
+
+// Drops the most recently added occurrence of `stop`; the start stays.
+bool RoutePlan::erase(int stop) {
+    size_t k = nodes.size();
+    while (k-- > 1 && nodes[k] != stop) {}
+    if (k == 0) return false;
+
+    size_t at = find(order.begin(), order.end(), k) - order.begin();
+    order.erase(order.begin() + at);
+    for (size_t& i : order) {
+        if (i > k) --i;
+    }
+    for (auto& row : costs) row.erase(row.begin() + k);
+    costs.erase(costs.begin() + k);
+    nodes.erase(nodes.begin() + k);
+    dont_look.erase(dont_look.begin() + k);
+    unlink_neighbours(k);
+    wake(order[at - 1]);
+    if (at < order.size()) wake(order[at]);
+    total = recompute_total();
+    return true;
+}
+
+void RoutePlan::wake(size_t node) {
+    dont_look[node] = 0;
+}
+
+// Candidate neighbours are ranked by the cheaper direction of the leg, ties
+// by stop index.
+pair<double, size_t> RoutePlan::rank(size_t a, size_t b) const {
+    return {min(leg(a, b), leg(b, a)), b};
+}
+
+vector<size_t> RoutePlan::closest_to(size_t a) const {
+    size_t n = nodes.size();
+    size_t keep = min(NEIGHBOURS, n - 1);
+    vector<pair<double, size_t>> by_cost;
+    for (size_t b = 0; b < n; ++b) {
+        if (b != a) by_cost.push_back(rank(a, b));
+    }
+    partial_sort(by_cost.begin(), by_cost.begin() + keep, by_cost.end());
+    vector<size_t> list;
+    for (size_t k = 0; k < keep; ++k) list.push_back(by_cost[k].second);
+    return list;
+}
+
+void RoutePlan::build_neighbours() {
+    near.assign(nodes.size(), {});
+    for (size_t a = 0; a < nodes.size(); ++a) near[a] = closest_to(a);
+}
+
+// Keeps built neighbour lists current after stop `idx` was appended: it
+// enters each list it ranks into and gets a list of its own.
+void RoutePlan::link_neighbours(size_t idx) {
+    if (near.size() != idx) {
+        near.clear();
+        return;
+    }
+    for (size_t a = 0; a < idx; ++a) {
+        vector<size_t>& list = near[a];
+        auto key = rank(a, idx);
+        auto at = find_if(list.begin(), list.end(), [&](size_t b) { return key < rank(a, b); });
+        if (at == list.end() && list.size() >= NEIGHBOURS) continue;
+        list.insert(at, idx);
+        if (list.size() > NEIGHBOURS) list.pop_back();
+    }
+    near.push_back(closest_to(idx));
+}
+
+// Keeps built neighbour lists current after stop `k` was removed and the
+// stops above it renumbered; only lists that contained it are re-ranked.
+void RoutePlan::unlink_neighbours(size_t k) {
+    if (near.size() != nodes.size() + 1) {
+        near.clear();
+        return;
+    }
+    near.erase(near.begin() + k);
+    for (size_t a = 0; a < near.size(); ++a) {
+        vector<size_t>& list = near[a];
+        if (find(list.begin(), list.end(), k) != list.end()) {
+            list = closest_to(a);
+            continue;
+        }
+        for (size_t& b : list) {
+            if (b > k) --b;
+        }
+    }
+}
+
+// Reverses order[p+1..q] so that order[p] is followed by order[q]. Legs are
+// directed, so the reversed inner stretch is priced from the backward prefix
+// sums.
+bool RoutePlan::try_two_opt(size_t p, size_t q, const vector<double>& fwd, const vector<double>& bwd) {
+    size_t n = order.size();
+    double delta = leg(order[p], order[q]) - leg(order[p], order[p + 1])
+                 + (bwd[q] - bwd[p + 1]) - (fwd[q] - fwd[p + 1]);
+    if (q + 1 < n) delta += leg(order[p + 1], order[q + 1]) - leg(order[q], order[q + 1]);
+    if (!(delta < -1e-9)) return false;
+
+    wake(order[p]);
+    wake(order[p + 1]);
+    wake(order[q]);
+    if (q + 1 < n) wake(order[q + 1]);
+    reverse(order.begin() + p + 1, order.begin() + q + 1);
+    total += delta;
+    return true;
+}
+
+// Moves the one to three stops starting at position i so that they follow
+// the stop at position j, or precede it.
+bool RoutePlan::try_or_opt(size_t i, size_t j) {
+    size_t n = order.size();
+    if (i == 0) return false;
+    for (size_t len = 1; len <= 3 && i + len <= n; ++len) {
+        if (j >= i && j < i + len) return false;
+        size_t prev = order[i - 1], first = order[i], last = order[i + len - 1];
+        bool has_next = i + len < n;
+        double removed = leg(prev, first);
+        if (has_next) removed += leg(last, order[i + len]) - leg(prev, order[i + len]);
+
+        for (size_t k : {j, j - 1}) {
+            if (j == 0 && k == j - 1) continue;
+            if (k + 1 >= i && k < i + len) continue;
+            size_t x = order[k];
+            bool has_y = k + 1 < n;
+            double delta = leg(x, first) - removed;
+            if (has_y) delta += leg(last, order[k + 1]) - leg(x, order[k + 1]);
+            if (!(delta < -1e-9)) continue;
+
+            wake(prev);
+            wake(first);
+            wake(last);
+            wake(x);
+            if (has_next) wake(order[i + len]);
+            if (has_y) wake(order[k + 1]);
+            vector<size_t> segment(order.begin() + i, order.begin() + i + len);
+            order.erase(order.begin() + i, order.begin() + i + len);
+            size_t at = k < i ? k + 1 : k + 1 - len;
+            order.insert(order.begin() + at, segment.begin(), segment.end());
+            total += delta;
+            return true;
+        }
+    }
+    return false;
+}
+
+double RoutePlan::recompute_total() const {
+    double sum = 0.0;
+    for (size_t i = 0; i + 1 < order.size(); ++i) sum += leg(order[i], order[i + 1]);
+    return sum;
+}
+
+bool RoutePlan::needs_improvement() const {
+    if (order.size() < 3) return false;
+    for (size_t i : order) {
+        if (!dont_look[i]) return true;
+    }
+    return false;
+}
+
+bool RoutePlan::improve(Deadline deadline) {
+    if (!needs_improvement()) return false;
+    if (near.size() != nodes.size()) build_neighbours();
+
+    size_t n = order.size();
+    vector<size_t> pos(nodes.size());
+    vector<double> fwd(n, 0.0), bwd(n, 0.0);
+    auto refresh = [&]() {
+        for (size_t i = 0; i < n; ++i) pos[order[i]] = i;
+        for (size_t i = 0; i + 1 < n; ++i) {
+            fwd[i + 1] = fwd[i] + leg(order[i], order[i + 1]);
+            bwd[i + 1] = bwd[i] + leg(order[i + 1], order[i]);
+        }
+    };
+    refresh();
+
+    bool changed = false;
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (size_t a = 0; a < nodes.size(); ++a) {
+            if (dont_look[a]) continue;
+            if (chrono::steady_clock::now() >= deadline) {
+                total = recompute_total();
+                return changed;
+            }
+            dont_look[a] = 1;
+            for (size_t b : near[a]) {
+                size_t i = pos[a], j = pos[b];
+                bool moved = (j > i + 1 && try_two_opt(i, j, fwd, bwd))
+                          || (i > j + 1 && try_two_opt(j, i, fwd, bwd))
+                          || try_or_opt(i, j);
+                if (moved) {
+                    refresh();
+                    changed = true;
+                    pending = true;
+                    break;
+                }
+            }
+        }
+    }
+    total = recompute_total();
+    return changed;
+}
+
+vector<int> RoutePlan::stops() const {
+    vector<int> path;
+    path.reserve(order.size());
+    for (size_t i : order) path.push_back(nodes[i]);
+    return path;
+}
+
+vector<double> RoutePlan::arrivals() const {
+    vector<double> at(order.size(), 0.0);
+    for (size_t i = 1; i < order.size(); ++i) at[i] = at[i - 1] + leg(order[i - 1], order[i]);
+    return at;
+}
+
+vector<int> greedy_route(const RoadNetwork& graph, int start, const vector<int>& destinations) {
+    vector<int> stops{start};
+    stops.insert(stops.end(), destinations.begin(), destinations.end());
+    DistanceMatrix matrix = many_to_many(graph, stops, destinations);
+    return greedy_route(matrix, start, destinations);
+}
+
+vector<int> greedy_route(const DistanceMatrix& matrix, int start, const vector<int>& destinations) {
     vector<int> remaining = destinations;
     vector<int> path{start};
     int current = start;
@@ -13,23 +418,7 @@ vector<int> greedy_route(const RoadNetwork& graph, int start, const std::vector<
         auto best_it = remaining.end();
 
         for (auto it = remaining.begin(); it != remaining.end(); ++it) {
-            auto subpath = graph.dijkstra(current, *it);
-            if (subpath.empty()) continue;
-
-            double cost = 0.0;
-            for (size_t k = 0; k < subpath.size() - 1; ++k) {
-                int u = subpath[k];
-                int v = subpath[k + 1];
-                auto adj_it = graph.get_adj().find(u);
-                if (adj_it == graph.get_adj().end()) continue;
-                for (const auto& e : adj_it->second) {
-                    if (e.to == v) {
-                        cost += e.weight;
-                        break;
-                    }
-                }
-            }
-
+            double cost = matrix.between(current, *it);
             if (cost < min_cost) {
                 min_cost = cost;
                 next = *it;
@@ -48,22 +437,15 @@ vector<int> greedy_route(const RoadNetwork& graph, int start, const std::vector<
 }
 
 double route_cost(const RoadNetwork& graph, const vector<int>& path) {
+    if (path.size() < 2) return 0.0;
+    DistanceMatrix matrix = many_to_many(graph, path, path);
+    return route_cost(matrix, path);
+}
+
+double route_cost(const DistanceMatrix& matrix, const vector<int>& path) {
     double cost = 0.0;
-    for (size_t i = 0; i < path.size() - 1; ++i) {
-        auto subpath = graph.dijkstra(path[i], path[i+1]);
-        cost += subpath.size() - 1;
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        cost += matrix.between(path[i], path[i + 1]);
     }
     return cost;
 }
-
-vector<vector<int>> partition_deliveries(const vector<Delivery>& deliveries, int num_vehicles) {
-    vector<Delivery> sorted = deliveries;
-    sort(sorted.begin(), sorted.end(), [](const Delivery& a, const Delivery& b){
-        return a.dest_id < b.dest_id;
-    });
-    vector<vector<int>> partitions(num_vehicles);
-    for (size_t i = 0; i < sorted.size(); ++i) {
-        partitions[i % num_vehicles].push_back(sorted[i].id);
-    }
-    return partitions;
-}
\ No newline at end of file
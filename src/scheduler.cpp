@@ -3,15 +3,16 @@
 #include <algorithm>
 #include <limits>
 #include <iostream>
+#include <cmath>
 
 Scheduler::Scheduler(RoadNetwork& g, HashTable<int, Location>& loc_db,
                      double minx, double miny, double maxx, double maxy)
     : graph(g),
       location_db(loc_db),
       location_qt(minx, miny, maxx, maxy),
-      vehicle_qt(minx, miny, maxx, maxy),
-      delivery_db(101, [](int k){ return static_cast<size_t>(k); }),
-      vehicle_db(101, [](int k){ return static_cast<size_t>(k); }),
+      vehicle_qt(make_unique<QuadTree>(minx, miny, maxx, maxy)),
+      delivery_db(101),
+      vehicle_db(101),
       qt_min_x(minx), qt_min_y(miny),
       qt_max_x(maxx), qt_max_y(maxy)
 {}
@@ -24,68 +25,84 @@ void Scheduler::add_delivery(Delivery del) {
 void Scheduler::add_vehicle(Vehicle veh) {
     veh.current_x = veh.current_pos.x;
     veh.current_y = veh.current_pos.y;
+    // Re-adding an id publishes a new entry and retires the old one; the pin
+    // keeps the old entry readable while the index is re-pointed at the new.
+    EpochDomain::Guard pin = vehicle_db.pin();
     vehicle_db.insert(veh.id, veh);
-
-    auto veh_opt = vehicle_db.find(veh.id);
-    if (veh_opt) {
-        vehicle_qt.insert_vehicle(*veh_opt);
-    }
+    auto veh_ref = vehicle_db.find(veh.id);
+    if (veh_ref) vehicle_qt->insert_vehicle(veh_ref.get());
 }
 
 void Scheduler::add_location_to_quadtree(Location* loc) {
     if (loc) location_qt.insert_location(loc);
 }
 
+void Scheduler::build_location_index() {
+    location_qt.build();
+}
+
+void Scheduler::set_vehicle_index(VehicleIndexKind kind, double cell_size) {
+    if (kind == VehicleIndexKind::Grid) {
+        vehicle_qt = make_unique<GridIndex>(cell_size);
+    } else {
+        vehicle_qt = make_unique<QuadTree>(qt_min_x, qt_min_y, qt_max_x, qt_max_y);
+    }
+    index_kind = kind;
+    vehicle_db.for_each([&](const int&, Vehicle& veh) {
+        vehicle_qt->insert_vehicle(&veh);
+    });
+}
+
+VehicleIndexKind Scheduler::vehicle_index() const {
+    return index_kind;
+}
+
 void Scheduler::update_vehicle_position(int veh_id, double new_x, double new_y) {
-    auto opt = vehicle_db.find(veh_id);
-    if (!opt) return;
-    Vehicle* veh = *opt;
+    auto veh_ref = vehicle_db.find(veh_id);
+    if (!veh_ref) return;
+    Vehicle* veh = veh_ref.get();
     veh->current_x = new_x;
     veh->current_y = new_y;
-    rebuild_vehicle_qt();
+    vehicle_qt->update_vehicle_position(veh_id, new_x, new_y);
 }
 
-void Scheduler::rebuild_vehicle_qt() {
-    vehicle_qt = QuadTree(qt_min_x, qt_min_y, qt_max_x, qt_max_y);
-
-    for (int i = 1; i <= 100; ++i) {
-        auto opt = vehicle_db.find(i);
-        if (opt) {
-            vehicle_qt.insert_vehicle(*opt);
-        }
-    }
+pair<Location*, Vehicle*> Scheduler::find_nearest_vehicle(double x, double y, double load) {
+    auto found = vehicle_qt->k_nearest(x, y, 1, [load](const Location*, const Vehicle* veh) {
+        return veh && veh->available && veh->current_load + load <= veh->capacity;
+    });
+    if (found.empty()) return {nullptr, nullptr};
+    return found[0];
 }
 
-pair<Location*, Vehicle*> Scheduler::find_nearest_vehicle(double x, double y) {
-    rebuild_vehicle_qt();
-    return vehicle_qt.find_nearest_vehicle(x, y);
-}
+bool Scheduler::assign_delivery(int del_id, int veh_id) {
+    auto del_ref = delivery_db.find(del_id);
+    auto veh_ref = vehicle_db.find(veh_id);
+    if (!del_ref || !veh_ref) return false;
 
-void Scheduler::assign_delivery(int del_id, int veh_id) {
-    auto del_opt = delivery_db.find(del_id);
-    auto veh_opt = vehicle_db.find(veh_id);
-    if (!del_opt || !veh_opt) return;
+    Delivery* del = del_ref.get();
+    Vehicle* veh = veh_ref.get();
 
-    Delivery* del = *del_opt;
-    Vehicle* veh = *veh_opt;
+    if (veh->current_load + del->weight > veh->capacity) return false;
 
-    if (veh->current_load + del->weight > veh->capacity) return;
+    // The plan stays anchored where the vehicle took its first delivery;
+    // each further drop-off is inserted into it rather than re-planned. A
+    // drop-off the plan cannot reach leaves the delivery unassigned.
+    auto [it, fresh] = route_plans.try_emplace(veh_id, veh->current_pos.id);
+    if (!it->second.insert(graph, del->dest_id)) {
+        if (fresh) route_plans.erase(it);
+        return false;
+    }
 
     del->assigned_vehicle = veh_id;
     del->status = "assigned";
     veh->assigned_deliveries.push_back(del_id);
     veh->current_load += del->weight;
+    publish_route(veh, it->second);
+    return true;
+}
 
-    vector<int> destinations;
-    for (int d : veh->assigned_deliveries) {
-        auto d_opt = delivery_db.find(d);
-        if (d_opt) destinations.push_back((*d_opt)->dest_id);
-    }
-
-    if (!destinations.empty()) {
-        veh->route = greedy_route(graph, veh->current_pos.id, destinations);
-    }
-
+void Scheduler::publish_route(Vehicle* veh, const RoutePlan& plan) {
+    veh->route = plan.stops();
     veh->available = veh->assigned_deliveries.empty();
 
     if (!veh->route.empty()) {
@@ -93,7 +110,7 @@ void Scheduler::assign_delivery(int del_id, int veh_id) {
         auto next_loc_opt = location_db.find(last_dest);
         if (next_loc_opt) {
             const Location* next_loc = *next_loc_opt;
-            update_vehicle_position(veh_id, next_loc->x, next_loc->y);
+            update_vehicle_position(veh->id, next_loc->x, next_loc->y);
             veh->current_pos = *next_loc;
         }
     }
@@ -104,43 +121,273 @@ void Scheduler::process_deliveries() {
     int attempts = 0;
     size_t consecutive_fails = 0;
     size_t initial_size = pending.size();
+    vector<Delivery> unplaced;
 
     while (!pending.empty() && attempts < MAX_ATTEMPTS) {
         attempts++;
-        Delivery del = pending.pop();
+        sync_traffic();
+        const Delivery& del = pending.top();
 
-        if (del.status != "pending") continue;
+        if (del.status != "pending") {
+            pending.pop();
+            continue;
+        }
 
         auto src_opt = location_db.find(del.source_id);
         if (!src_opt) {
-            pending.push(std::move(del));
             consecutive_fails++;
             continue;
         }
 
-        auto [loc, veh] = find_nearest_vehicle((*src_opt)->x, (*src_opt)->y);
-        if (veh && veh->current_load + del.weight <= veh->capacity) {
-            assign_delivery(del.id, veh->id);
-            consecutive_fails = 0;
+        auto [loc, veh] = find_nearest_vehicle((*src_opt)->x, (*src_opt)->y, del.weight);
+        if (veh) {
+            Delivery next = pending.pop();
+            if (assign_delivery(next.id, veh->id)) {
+                consecutive_fails = 0;
+            } else {
+                unplaced.push_back(move(next));
+                consecutive_fails++;
+            }
         } else {
-            pending.push(std::move(del));
             consecutive_fails++;
         }
 
         if (consecutive_fails > initial_size) break;
     }
+    for (auto& del : unplaced) pending.push(move(del));
+}
+
+vector<Delivery> Scheduler::next_window(size_t size) {
+    vector<Delivery> window;
+    while (!pending.empty() && window.size() < max<size_t>(size, 1)) {
+        Delivery del = pending.pop();
+        if (del.status == "pending") window.push_back(move(del));
+    }
+    return window;
+}
+
+// Solves one window and assigns the matched deliveries; the rest are left in
+// `window`. Each delivery is offered only its `candidates` straight-line
+// nearest feasible vehicles, and those arcs are priced by road distance from
+// the vehicle's position to the pickup.
+size_t Scheduler::dispatch_window(vector<Delivery>& window, size_t candidates) {
+    vector<Vehicle*> vehicles;
+    vector<int> positions;
+    unordered_map<int, size_t> column_of;
+    vector<vector<size_t>> shortlist(window.size());
+    vector<int> pickups(window.size());
+
+    // One batch query shortlists every delivery whose pickup is known.
+    vector<size_t> query_row;
+    vector<double> qx, qy;
+    for (size_t i = 0; i < window.size(); ++i) {
+        pickups[i] = window[i].source_id;
+        auto src_opt = location_db.find(window[i].source_id);
+        if (!src_opt) continue;
+        query_row.push_back(i);
+        qx.push_back((*src_opt)->x);
+        qy.push_back((*src_opt)->y);
+    }
+    vector<size_t> offsets;
+    vector<VehicleIndex::Item> found;
+    vehicle_qt->k_nearest_batch(qx.data(), qy.data(), query_row.size(), candidates,
+                                [&](size_t q, const Location*, const Vehicle* veh) {
+        return veh && veh->available && veh->current_load + window[query_row[q]].weight <= veh->capacity;
+    }, offsets, found);
+
+    for (size_t q = 0; q < query_row.size(); ++q) {
+        for (size_t j = offsets[q]; j < offsets[q + 1]; ++j) {
+            Vehicle* veh = found[j].second;
+            auto [it, fresh] = column_of.emplace(veh->id, vehicles.size());
+            if (fresh) {
+                vehicles.push_back(veh);
+                positions.push_back(veh->current_pos.id);
+            }
+            shortlist[query_row[q]].push_back(it->second);
+        }
+    }
+    if (vehicles.empty()) return 0;
+
+    DistanceMatrix roads = many_to_many(graph, positions, pickups);
+    double max_cost = 0.0;
+    for (size_t i = 0; i < window.size(); ++i) {
+        auto& arcs = shortlist[i];
+        arcs.erase(remove_if(arcs.begin(), arcs.end(), [&](size_t v) { return isinf(roads.cost(v, i)); }),
+                   arcs.end());
+        for (size_t v : arcs) max_cost = max(max_cost, roads.cost(v, i));
+    }
+
+    // Leaving a delivery out costs more than any complete matching, so the
+    // solver serves as many as it can and minimizes distance among those.
+    double unassigned_cost = (max_cost + 1.0) * static_cast<double>(window.size());
+
+    // A match can still fail in assign_delivery, e.g. when the vehicle's
+    // plan cannot reach the drop-off. That arc is dropped and the remaining
+    // rows are solved again against the vehicles still free, so the delivery
+    // can go to its next-best vehicle instead of repeating the same match.
+    vector<char> done(window.size(), 0);
+    size_t assigned = 0;
+    for (bool retry = true; retry;) {
+        retry = false;
+        SparseCostMatrix costs(vehicles.size());
+        for (size_t i = 0; i < window.size(); ++i) {
+            if (!done[i]) {
+                for (size_t v : shortlist[i]) {
+                    const Vehicle* veh = vehicles[v];
+                    if (!veh->available || veh->current_load + window[i].weight > veh->capacity) continue;
+                    costs.add_arc(static_cast<int>(v), roads.cost(v, i));
+                }
+            }
+            costs.end_row();
+        }
+        if (costs.cols.empty()) break;
+
+        AssignmentResult match = auction_assign(costs, unassigned_cost);
+        for (size_t i = 0; i < window.size(); ++i) {
+            int col = match.col_of_row[i];
+            if (done[i] || col == AssignmentResult::UNASSIGNED) continue;
+            if (assign_delivery(window[i].id, vehicles[col]->id)) {
+                done[i] = 1;
+                ++assigned;
+            } else {
+                auto& arcs = shortlist[i];
+                arcs.erase(find(arcs.begin(), arcs.end(), static_cast<size_t>(col)));
+                retry = true;
+            }
+        }
+    }
+
+    vector<Delivery> leftover;
+    for (size_t i = 0; i < window.size(); ++i) {
+        if (!done[i]) leftover.push_back(move(window[i]));
+    }
+    window.swap(leftover);
+    return assigned;
+}
+
+size_t Scheduler::dispatch_tick(const DispatchOptions& opts) {
+    sync_traffic();
+    vector<Delivery> window = next_window(opts.window);
+    size_t assigned = dispatch_window(window, opts.candidates);
+    for (auto& del : window) pending.push(move(del));
+    improve_routes(opts.improve_budget);
+    return assigned;
+}
+
+// Drains the queue window by window, then requeues what was left and makes
+// another pass while the previous one still assigned something.
+void Scheduler::process_deliveries_batch(const DispatchOptions& opts) {
+    size_t assigned;
+    do {
+        assigned = 0;
+        vector<Delivery> leftover;
+        while (!pending.empty()) {
+            sync_traffic();
+            vector<Delivery> window = next_window(opts.window);
+            assigned += dispatch_window(window, opts.candidates);
+            for (auto& del : window) leftover.push_back(move(del));
+            improve_routes(opts.improve_budget);
+        }
+        for (auto& del : leftover) pending.push(move(del));
+    } while (assigned > 0 && !pending.empty());
+}
+
+// Improves every route plan with work left, in parallel and against one
+// shared deadline, and publishes the changed routes. Returns how many
+// changed.
+size_t Scheduler::improve_routes(chrono::microseconds budget) {
+    vector<pair<int, RoutePlan*>> work;
+    for (auto& [id, plan] : route_plans) {
+        plan.refresh(graph);
+        if (plan.needs_improvement()) work.push_back({id, &plan});
+    }
+    if (work.empty()) return 0;
+
+    auto deadline = chrono::steady_clock::now() + budget;
+    vector<char> changed(work.size(), 0);
+    ThreadPool::shared().parallel_for(work.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t k = begin; k < end; ++k) changed[k] = work[k].second->improve(deadline);
+    });
+
+    size_t count = 0;
+    for (size_t k = 0; k < work.size(); ++k) {
+        if (!changed[k]) continue;
+        auto veh_ref = vehicle_db.find(work[k].first);
+        if (veh_ref) publish_route(veh_ref.get(), *work[k].second);
+        ++count;
+    }
+    return count;
+}
+
+// Plans all pending deliveries at once over the available vehicles with the
+// capacitated sweep solver; whatever it cannot place goes back to the queue.
+size_t Scheduler::plan_routes(const VrpOptions& opts) {
+    vector<Delivery> batch;
+    while (!pending.empty()) {
+        Delivery del = pending.pop();
+        if (del.status == "pending") batch.push_back(move(del));
+    }
+    vector<Vehicle> fleet;
+    vehicle_db.for_each([&](const int&, const Vehicle& veh) {
+        if (veh.available) fleet.push_back(veh);
+    });
+
+    VrpSolution sol = solve_vrp(graph, location_db, fleet, batch, opts);
+
+    size_t assigned = 0;
+    for (size_t v = 0; v < fleet.size(); ++v) {
+        if (sol.deliveries[v].empty()) continue;
+        auto veh_ref = vehicle_db.find(fleet[v].id);
+        if (!veh_ref) continue;
+        Vehicle* veh = veh_ref.get();
+        for (int id : sol.deliveries[v]) {
+            auto del_ref = delivery_db.find(id);
+            if (!del_ref) continue;
+            Delivery* del = del_ref.get();
+            del->assigned_vehicle = veh->id;
+            del->status = "assigned";
+            veh->assigned_deliveries.push_back(id);
+            veh->current_load += del->weight;
+            ++assigned;
+        }
+        RoutePlan& plan = route_plans[veh->id] = move(sol.plans[v]);
+        publish_route(veh, plan);
+    }
+
+    unordered_map<int, size_t> index_of;
+    for (size_t i = 0; i < batch.size(); ++i) index_of[batch[i].id] = i;
+    for (int id : sol.unassigned) pending.push(move(batch[index_of[id]]));
+    return assigned;
+}
+
+// Arrival time at each stop of the vehicle's route when it leaves at
+// `depart`; see RoadNetwork::arrivals_at().
+vector<TimePoint> Scheduler::route_arrivals(int veh_id, TimePoint depart) const {
+    auto veh_ref = vehicle_db.find(veh_id);
+    if (!veh_ref) return {};
+    return graph.arrivals_at(veh_ref->route, depart);
 }
 
 void Scheduler::update_traffic(int from, int to, double new_weight) {
     graph.update_edge_weight(from, to, new_weight);
 }
 
+// The feed's reader thread never touches the graph; sealed batches are
+// applied here, between dispatch steps, where no query is in flight.
+void Scheduler::set_traffic_feed(TrafficFeed* feed) {
+    traffic_feed = feed;
+}
+
+void Scheduler::sync_traffic() {
+    if (traffic_feed && traffic_feed->has_pending()) traffic_feed->apply_pending(graph);
+}
+
 vector<Delivery> Scheduler::sorted_deliveries() const {
     vector<Delivery> result;
-    for (int i = 0; i < 10000; ++i) {
-        auto opt = delivery_db.find(i);
-        if (opt) result.push_back(**opt);
-    }
+    result.reserve(delivery_db.size());
+    delivery_db.for_each([&](const int&, const Delivery& d) {
+        result.push_back(d);
+    });
 
     sort(result.begin(), result.end(), [](const Delivery& a, const Delivery& b) {
         if (a.priority != b.priority) return a.priority > b.priority;
@@ -150,29 +397,26 @@ vector<Delivery> Scheduler::sorted_deliveries() const {
     return result;
 }
 
-HashTable<int, Vehicle>& Scheduler::get_vehicle_db() {
+ConcurrentHashTable<int, Vehicle>& Scheduler::get_vehicle_db() {
     return vehicle_db;
 }
 
-const HashTable<int, Vehicle>& Scheduler::get_vehicle_db() const {
+const ConcurrentHashTable<int, Vehicle>& Scheduler::get_vehicle_db() const {
     return vehicle_db;
 }
 
 Scheduler::Stats Scheduler::get_stats() const {
     Stats s;
-    for (int i = 0; i < 10000; ++i) {
-        auto opt = delivery_db.find(i);
-        if (opt) {
-            s.total_deliveries++;
-            if ((*opt)->status == "assigned") {
-                s.assigned++;
-                s.total_load_assigned += (*opt)->weight;
-            } else if ((*opt)->status == "pending") {
-                s.pending++;
-            } else {
-                s.unassigned++;
-            }
+    delivery_db.for_each([&](const int&, const Delivery& d) {
+        s.total_deliveries++;
+        if (d.status == "assigned") {
+            s.assigned++;
+            s.total_load_assigned += d.weight;
+        } else if (d.status == "pending") {
+            s.pending++;
+        } else {
+            s.unassigned++;
         }
-    }
+    });
     return s;
 }
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "../include/snapshot.hpp"
+#include "../include/text_scanner.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace {
+
+constexpr char MAGIC[8] = {'S', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+enum SectionKind : uint32_t {
+    NODE_IDS = 1,
+    OFFSETS,
+    TARGETS,
+    WEIGHTS,
+    BASE_WEIGHTS,
+    REV_OFFSETS,
+    REV_SOURCES,
+    REV_SLOTS,
+    XS,
+    YS,
+    STRINGS,
+    LOCATIONS,
+    VEHICLES,
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t section_count;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+struct Section {
+    uint32_t kind;
+    uint32_t elem_size;
+    uint64_t offset;
+    uint64_t count;
+};
+
+struct LocationRecord {
+    int32_t id;
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t type_offset;
+    uint32_t type_length;
+    uint32_t padding;
+    double x;
+    double y;
+};
+
+struct VehicleRecord {
+    int32_t id;
+    int32_t location;
+    double capacity;
+    double speed;
+};
+
+static_assert(sizeof(Header) == 40, "snapshot header layout");
+static_assert(sizeof(Section) == 24, "snapshot section layout");
+static_assert(sizeof(LocationRecord) == 40, "snapshot location layout");
+static_assert(sizeof(VehicleRecord) == 24, "snapshot vehicle layout");
+
+size_t align8(size_t n) {
+    return (n + 7) & ~static_cast<size_t>(7);
+}
+
+// FNV-1a over 64-bit words with a final avalanche; only meant to catch
+// truncated or corrupted files.
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    for (; i < size; ++i) h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+class SnapshotWriter {
+private:
+    vector<Section> table;
+    vector<char> payload;
+
+public:
+    // Appends items as an array of S, converting element-wise when the
+    // in-memory type differs (size_t is stored as uint64_t).
+    template<typename S, typename T>
+    void add(uint32_t kind, const T* items, size_t count) {
+        payload.resize(align8(payload.size()));
+        table.push_back({kind, static_cast<uint32_t>(sizeof(S)), payload.size(), count});
+        size_t at = payload.size();
+        payload.resize(at + count * sizeof(S));
+        if constexpr (is_same_v<S, T>) {
+            if (count) memcpy(payload.data() + at, items, count * sizeof(S));
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                S value = static_cast<S>(items[i]);
+                memcpy(payload.data() + at + i * sizeof(S), &value, sizeof(S));
+            }
+        }
+    }
+
+    template<typename S, typename T>
+    void add(uint32_t kind, const vector<T>& items) {
+        add<S>(kind, items.data(), items.size());
+    }
+
+    bool write(const string& filename) {
+        size_t table_bytes = align8(table.size() * sizeof(Section));
+        size_t base = sizeof(Header) + table_bytes;
+        for (auto& s : table) s.offset += base;
+
+        vector<char> body(table_bytes + payload.size(), '\0');
+        if (!table.empty()) memcpy(body.data(), table.data(), table.size() * sizeof(Section));
+        if (!payload.empty()) memcpy(body.data() + table_bytes, payload.data(), payload.size());
+
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = ENDIAN_MARK;
+        header.header_size = sizeof(Header);
+        header.section_count = static_cast<uint32_t>(table.size());
+        header.payload_size = body.size();
+        header.checksum = checksum(body.data(), body.size());
+
+        ofstream file(filename, ios::binary | ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(body.data(), static_cast<streamsize>(body.size()));
+        return static_cast<bool>(file);
+    }
+};
+
+class SnapshotReader {
+private:
+    const char* base;
+    size_t size;
+    vector<Section> table;
+
+public:
+    SnapshotReader(const char* data, size_t length) : base(data), size(length) {
+        Header header;
+        if (size < sizeof(Header)) throw runtime_error("Snapshot is truncated");
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) throw runtime_error("Not a snapshot file");
+        if (header.byte_order != ENDIAN_MARK) throw runtime_error("Snapshot was written with another byte order");
+        if (header.version != SNAPSHOT_VERSION) {
+            throw runtime_error("Snapshot version " + to_string(header.version) + " is not supported");
+        }
+        if (header.header_size != sizeof(Header) || header.payload_size != size - sizeof(Header)) {
+            throw runtime_error("Snapshot is truncated");
+        }
+        if (checksum(base + sizeof(Header), size - sizeof(Header)) != header.checksum) {
+            throw runtime_error("Snapshot checksum mismatch");
+        }
+        if (header.section_count > (size - sizeof(Header)) / sizeof(Section)) {
+            throw runtime_error("Snapshot section table is corrupt");
+        }
+        table.resize(header.section_count);
+        if (!table.empty()) memcpy(table.data(), base + sizeof(Header), table.size() * sizeof(Section));
+    }
+
+    // Points into the mapping; the section must hold an aligned array of S.
+    template<typename S>
+    const S* find(uint32_t kind, size_t& count) const {
+        for (const auto& s : table) {
+            if (s.kind != kind) continue;
+            if (s.elem_size != sizeof(S) || s.offset % alignof(S) != 0 || s.offset > size ||
+                s.count > (size - s.offset) / sizeof(S)) {
+                throw runtime_error("Snapshot section " + to_string(kind) + " is corrupt");
+            }
+            count = static_cast<size_t>(s.count);
+            return reinterpret_cast<const S*>(base + s.offset);
+        }
+        throw runtime_error("Snapshot section " + to_string(kind) + " is missing");
+    }
+
+    template<typename S, typename T>
+    void read(uint32_t kind, vector<T>& out) const {
+        size_t count;
+        const S* items = find<S>(kind, count);
+        out.assign(items, items + count);
+    }
+};
+
+uint32_t intern(const string& s, unordered_map<string, uint32_t>& seen, vector<char>& pool) {
+    auto it = seen.find(s);
+    if (it != seen.end()) return it->second;
+    if (pool.size() + s.size() > UINT32_MAX) throw runtime_error("Snapshot string pool overflow");
+    uint32_t at = static_cast<uint32_t>(pool.size());
+    pool.insert(pool.end(), s.begin(), s.end());
+    seen.emplace(s, at);
+    return at;
+}
+
+// Row offsets start at 0, never decrease and end at `edges`.
+bool valid_offsets(const vector<size_t>& offsets, size_t edges) {
+    return !offsets.empty() && offsets.front() == 0 && offsets.back() == edges &&
+           is_sorted(offsets.begin(), offsets.end());
+}
+
+template<typename T>
+bool all_below(const vector<T>& values, size_t bound) {
+    return all_of(values.begin(), values.end(), [bound](T v) {
+        return v >= 0 && static_cast<size_t>(v) < bound;
+    });
+}
+
+}
+
+bool write_snapshot(const string& filename, const RoadNetwork& graph, const vector<Location*>& all_locs,
+                    const HashTable<int, Vehicle>& vehicle_db, const vector<int>& vehicle_ids) {
+    const CsrGraph& g = graph.csr();
+    SnapshotWriter out;
+    out.add<int32_t>(NODE_IDS, g.node_ids);
+    out.add<uint64_t>(OFFSETS, g.offsets);
+    out.add<int32_t>(TARGETS, g.targets);
+    out.add<double>(WEIGHTS, g.weights);
+    out.add<double>(BASE_WEIGHTS, g.base_weights);
+    out.add<uint64_t>(REV_OFFSETS, g.rev_offsets);
+    out.add<int32_t>(REV_SOURCES, g.rev_sources);
+    out.add<uint64_t>(REV_SLOTS, g.rev_slots);
+    out.add<double>(XS, g.xs);
+    out.add<double>(YS, g.ys);
+
+    unordered_map<string, uint32_t> seen;
+    vector<char> pool;
+    vector<LocationRecord> locations;
+    locations.reserve(all_locs.size());
+    for (const Location* loc : all_locs) {
+        if (!loc) continue;
+        LocationRecord r{};
+        r.id = loc->id;
+        r.name_offset = intern(loc->name, seen, pool);
+        r.name_length = static_cast<uint32_t>(loc->name.size());
+        r.type_offset = intern(loc->type, seen, pool);
+        r.type_length = static_cast<uint32_t>(loc->type.size());
+        r.x = loc->x;
+        r.y = loc->y;
+        locations.push_back(r);
+    }
+    out.add<char>(STRINGS, pool);
+    out.add<LocationRecord>(LOCATIONS, locations);
+
+    vector<VehicleRecord> vehicles;
+    vehicles.reserve(vehicle_ids.size());
+    for (int id : vehicle_ids) {
+        auto opt = vehicle_db.find(id);
+        if (!opt) continue;
+        const Vehicle& v = **opt;
+        vehicles.push_back({v.id, v.current_pos.id, v.capacity, v.speed});
+    }
+    out.add<VehicleRecord>(VEHICLES, vehicles);
+
+    return out.write(filename);
+}
+
+bool load_snapshot(const string& filename, RoadNetwork& graph, HashTable<int, Location>& loc_db,
+                   vector<Location*>& all_locs, HashTable<int, Vehicle>& vehicle_db, vector<int>& vehicle_ids) {
+    MappedFile file(filename);
+    if (!file.is_open()) return false;
+    SnapshotReader in(file.data(), file.size());
+
+    CsrGraph g;
+    in.read<int32_t>(NODE_IDS, g.node_ids);
+    in.read<uint64_t>(OFFSETS, g.offsets);
+    in.read<int32_t>(TARGETS, g.targets);
+    in.read<double>(WEIGHTS, g.weights);
+    in.read<double>(BASE_WEIGHTS, g.base_weights);
+    in.read<uint64_t>(REV_OFFSETS, g.rev_offsets);
+    in.read<int32_t>(REV_SOURCES, g.rev_sources);
+    in.read<uint64_t>(REV_SLOTS, g.rev_slots);
+    in.read<double>(XS, g.xs);
+    in.read<double>(YS, g.ys);
+
+    size_t n = g.node_ids.size();
+    size_t m = g.targets.size();
+    if (g.offsets.size() != n + 1 || g.offsets[n] != m || g.weights.size() != m || g.base_weights.size() != m ||
+        g.rev_offsets.size() != n + 1 || g.rev_sources.size() != m || g.rev_slots.size() != m ||
+        g.xs.size() != n || g.ys.size() != n) {
+        throw runtime_error("Snapshot graph sections are inconsistent");
+    }
+    // Searches index by these without bounds checks.
+    if (!valid_offsets(g.offsets, m) || !valid_offsets(g.rev_offsets, m) || !all_below(g.targets, n) ||
+        !all_below(g.rev_sources, n) || !all_below(g.rev_slots, m)) {
+        throw runtime_error("Snapshot graph indices are out of range");
+    }
+    size_t pool_size, location_count, vehicle_count;
+    const char* pool = in.find<char>(STRINGS, pool_size);
+    const LocationRecord* locations = in.find<LocationRecord>(LOCATIONS, location_count);
+    const VehicleRecord* vehicles = in.find<VehicleRecord>(VEHICLES, vehicle_count);
+    for (size_t i = 0; i < location_count; ++i) {
+        const LocationRecord& r = locations[i];
+        if (size_t(r.name_offset) + r.name_length > pool_size || size_t(r.type_offset) + r.type_length > pool_size) {
+            throw runtime_error("Snapshot location strings are corrupt");
+        }
+    }
+
+    // Everything is validated; nothing below can fail halfway.
+    g.node_index.reserve(n);
+    for (size_t i = 0; i < n; ++i) g.node_index.emplace(g.node_ids[i], static_cast<int>(i));
+    graph.adopt(move(g));
+
+    loc_db.reserve(loc_db.size() + location_count);
+    all_locs.reserve(all_locs.size() + location_count);
+    for (size_t i = 0; i < location_count; ++i) {
+        const LocationRecord& r = locations[i];
+        Location loc = {r.id, string(pool + r.name_offset, r.name_length), r.x, r.y,
+                        string(pool + r.type_offset, r.type_length)};
+        loc_db.insert(r.id, loc);
+        auto opt = loc_db.find(r.id);
+        if (opt) all_locs.push_back(*opt);
+    }
+
+    vehicle_db.reserve(vehicle_db.size() + vehicle_count);
+    vehicle_ids.reserve(vehicle_ids.size() + vehicle_count);
+    for (size_t i = 0; i < vehicle_count; ++i) {
+        const VehicleRecord& r = vehicles[i];
+        auto loc_opt = loc_db.find(r.location);
+        if (!loc_opt) continue;
+        Vehicle v = {r.id, r.capacity, r.speed, **loc_opt};
+        vehicle_db.insert(r.id, v);
+        vehicle_ids.push_back(r.id);
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "../include/spatial_kernels.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPATIAL_X86 1
+#endif
+
+namespace {
+
+void dist2_scalar(const double* xs, const double* ys, size_t n, double x, double y, double* out) {
+    for (size_t i = 0; i < n; ++i) {
+        double dx = xs[i] - x;
+        double dy = ys[i] - y;
+        out[i] = dx*dx + dy*dy;
+    }
+}
+
+size_t within_scalar(const double* xs, const double* ys, size_t n, double x, double y, double r2, uint32_t* hits) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double dx = xs[i] - x;
+        double dy = ys[i] - y;
+        if (dx*dx + dy*dy <= r2) hits[count++] = static_cast<uint32_t>(i);
+    }
+    return count;
+}
+
+#ifdef SPATIAL_X86
+void dist2_sse2(const double* xs, const double* ys, size_t n, double x, double y, double* out) {
+    __m128d vx = _mm_set1_pd(x);
+    __m128d vy = _mm_set1_pd(y);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), vx);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), vy);
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+    }
+    dist2_scalar(xs + i, ys + i, n - i, x, y, out + i);
+}
+
+size_t within_sse2(const double* xs, const double* ys, size_t n, double x, double y, double r2, uint32_t* hits) {
+    __m128d vx = _mm_set1_pd(x);
+    __m128d vy = _mm_set1_pd(y);
+    __m128d vr = _mm_set1_pd(r2);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), vx);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), vy);
+        __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        int mask = _mm_movemask_pd(_mm_cmple_pd(d2, vr));
+        if (mask & 1) hits[count++] = static_cast<uint32_t>(i);
+        if (mask & 2) hits[count++] = static_cast<uint32_t>(i + 1);
+    }
+    size_t tail = within_scalar(xs + i, ys + i, n - i, x, y, r2, hits + count);
+    for (size_t k = 0; k < tail; ++k) hits[count + k] += static_cast<uint32_t>(i);
+    return count + tail;
+}
+
+__attribute__((target("avx2")))
+void dist2_avx2(const double* xs, const double* ys, size_t n, double x, double y, double* out) {
+    __m256d vx = _mm256_set1_pd(x);
+    __m256d vy = _mm256_set1_pd(y);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vy);
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+    }
+    dist2_sse2(xs + i, ys + i, n - i, x, y, out + i);
+}
+
+__attribute__((target("avx2")))
+size_t within_avx2(const double* xs, const double* ys, size_t n, double x, double y, double r2, uint32_t* hits) {
+    __m256d vx = _mm256_set1_pd(x);
+    __m256d vy = _mm256_set1_pd(y);
+    __m256d vr = _mm256_set1_pd(r2);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vy);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, vr, _CMP_LE_OQ));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            hits[count++] = static_cast<uint32_t>(i + bit);
+            mask &= mask - 1;
+        }
+    }
+    size_t tail = within_sse2(xs + i, ys + i, n - i, x, y, r2, hits + count);
+    for (size_t k = 0; k < tail; ++k) hits[count + k] += static_cast<uint32_t>(i);
+    return count + tail;
+}
+
+bool has_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+}
+
+void dist2_kernel(const double* xs, const double* ys, size_t n, double x, double y, double* out) {
+#ifdef SPATIAL_X86
+    if (has_avx2()) {
+        dist2_avx2(xs, ys, n, x, y, out);
+    } else {
+        dist2_sse2(xs, ys, n, x, y, out);
+    }
+#else
+    dist2_scalar(xs, ys, n, x, y, out);
+#endif
+}
+
+size_t within_kernel(const double* xs, const double* ys, size_t n, double x, double y, double r2, uint32_t* hits) {
+#ifdef SPATIAL_X86
+    if (has_avx2()) return within_avx2(xs, ys, n, x, y, r2, hits);
+    return within_sse2(xs, ys, n, x, y, r2, hits);
+#else
+    return within_scalar(xs, ys, n, x, y, r2, hits);
+#endif
+}
@@ -0,0 +1,217 @@
+#include "../include/text_scanner.hpp"
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date.
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = static_cast<unsigned>(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool digits(string_view text, size_t at, size_t count, int& out) {
+    if (at + count > text.size()) return false;
+    out = 0;
+    for (size_t i = at; i < at + count; ++i) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        out = out * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+}
+
+MappedFile::MappedFile(const string& path) {
+#if !defined(_WIN32)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    opened = true;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(p);
+            length = static_cast<size_t>(st.st_size);
+            mapped = true;
+            ::close(fd);
+            return;
+        }
+    }
+    char chunk[1 << 16];
+    ssize_t got;
+    while ((got = ::read(fd, chunk, sizeof(chunk))) > 0) buffer.append(chunk, static_cast<size_t>(got));
+    ::close(fd);
+#else
+    ifstream file(path, ios::binary);
+    if (!file) return;
+    opened = true;
+    buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+#endif
+    bytes = buffer.data();
+    length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (mapped) munmap(const_cast<char*>(bytes), length);
+#endif
+}
+
+bool MappedFile::is_open() const {
+    return opened;
+}
+
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+string_view MappedFile::text() const {
+    return string_view(bytes, length);
+}
+
+LineReader::LineReader(string_view text) : cur(text.data()), end(text.data() + text.size()) {}
+
+bool LineReader::next(string_view& line) {
+    if (cur >= end) return false;
+    const char* nl = static_cast<const char*>(memchr(cur, '\n', static_cast<size_t>(end - cur)));
+    const char* stop = nl ? nl : end;
+    const char* last = stop;
+    if (last > cur && last[-1] == '\r') --last;
+    line = string_view(cur, static_cast<size_t>(last - cur));
+    cur = nl ? nl + 1 : end;
+    return true;
+}
+
+FieldReader::FieldReader(string_view line) : cur(line.data()), end(line.data() + line.size()) {}
+
+string_view FieldReader::token() {
+    while (cur < end && is_space(*cur)) ++cur;
+    const char* start = cur;
+    while (cur < end && !is_space(*cur)) ++cur;
+    return string_view(start, static_cast<size_t>(cur - start));
+}
+
+bool FieldReader::read(int& out) {
+    string_view t = token();
+    if (!t.empty() && t[0] == '+') t.remove_prefix(1);
+    if (t.empty()) return false;
+    auto [p, ec] = from_chars(t.data(), t.data() + t.size(), out);
+    return ec == errc() && p == t.data() + t.size();
+}
+
+bool FieldReader::read(double& out) {
+    string_view t = token();
+    if (!t.empty() && t[0] == '+') t.remove_prefix(1);
+    if (t.empty()) return false;
+    auto [p, ec] = from_chars(t.data(), t.data() + t.size(), out);
+    return ec == errc() && p == t.data() + t.size();
+}
+
+bool FieldReader::read(string_view& out) {
+    out = token();
+    return !out.empty();
+}
+
+bool FieldReader::read(string& out) {
+    string_view t = token();
+    if (t.empty()) return false;
+    out.assign(t.data(), t.size());
+    return true;
+}
+
+size_t count_lines(string_view text) {
+    size_t n = static_cast<size_t>(count(text.begin(), text.end(), '\n'));
+    if (!text.empty() && text.back() != '\n') ++n;
+    return n;
+}
+
+bool parse_iso8601(string_view text, TimePoint& out) {
+    int year, month, day, hour, minute, second;
+    if (!digits(text, 0, 4, year) || text.size() < 19 || text[4] != '-' || !digits(text, 5, 2, month) ||
+        text[7] != '-' || !digits(text, 8, 2, day) || (text[10] != 'T' && text[10] != 't') ||
+        !digits(text, 11, 2, hour) || text[13] != ':' || !digits(text, 14, 2, minute) ||
+        text[16] != ':' || !digits(text, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+    size_t at = 19;
+    double fraction = 0.0;
+    if (at < text.size() && text[at] == '.') {
+        double scale = 0.1;
+        ++at;
+        size_t first = at;
+        while (at < text.size() && text[at] >= '0' && text[at] <= '9') {
+            fraction += (text[at] - '0') * scale;
+            scale /= 10;
+            ++at;
+        }
+        if (at == first) return false;
+    }
+
+    bool local = at == text.size();
+    int64_t offset = 0;
+    if (!local) {
+        char sign = text[at];
+        if ((sign == 'Z' || sign == 'z') && at + 1 == text.size()) {
+            ++at;
+        } else if (sign == '+' || sign == '-') {
+            int oh, om;
+            if (!digits(text, at + 1, 2, oh)) return false;
+            size_t m = at + 3 < text.size() && text[at + 3] == ':' ? at + 4 : at + 3;
+            if (!digits(text, m, 2, om) || m + 2 != text.size()) return false;
+            offset = (int64_t{oh} * 3600 + int64_t{om} * 60) * (sign == '+' ? 1 : -1);
+            at = text.size();
+        } else {
+            return false;
+        }
+    }
+
+    int64_t secs;
+    if (local) {
+        // No offset: local time, as the inputs have always been read.
+        tm fields{};
+        fields.tm_year = year - 1900;
+        fields.tm_mon = month - 1;
+        fields.tm_mday = day;
+        fields.tm_hour = hour;
+        fields.tm_min = minute;
+        fields.tm_sec = second;
+        fields.tm_isdst = -1;
+        time_t t = mktime(&fields);
+        if (t == static_cast<time_t>(-1)) return false;
+        secs = static_cast<int64_t>(t);
+    } else {
+        secs = days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400
+             + int64_t{hour} * 3600 + int64_t{minute} * 60 + second - offset;
+    }
+    out = TimePoint(chrono::duration_cast<TimePoint::duration>(
+        chrono::seconds(secs) + chrono::duration<double>(fraction)));
+    return true;
+}
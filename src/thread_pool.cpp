@@ -0,0 +1,126 @@
+#include "../include/thread_pool.hpp"
+#include <atomic>
+#include <algorithm>
+
+namespace {
+
+thread_local const ThreadPool* active_pool = nullptr;
+
+// Marks the calling thread as running inside a pool and restores the
+// previous marker on exit, including when the task throws.
+class ActiveScope {
+private:
+    const ThreadPool* saved;
+
+public:
+    explicit ActiveScope(const ThreadPool* pool) : saved(active_pool) {
+        active_pool = pool;
+    }
+    ~ActiveScope() {
+        active_pool = saved;
+    }
+    ActiveScope(const ActiveScope&) = delete;
+    ActiveScope& operator=(const ActiveScope&) = delete;
+};
+
+}
+
+ThreadPool::ThreadPool(size_t threads) {
+    size_t extra = threads > 1 ? threads - 1 : 0;
+    for (size_t i = 0; i < extra; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+size_t ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+void ThreadPool::worker_loop(size_t id) {
+    ActiveScope scope(this);
+    unsigned long seen = 0;
+    while (true) {
+        const function<void(size_t)>* task;
+        {
+            unique_lock<mutex> lock(mtx);
+            work_cv.wait(lock, [&] { return stopping || round != seen; });
+            if (stopping) return;
+            seen = round;
+            task = job;
+        }
+        exception_ptr error;
+        try {
+            (*task)(id);
+        } catch (...) {
+            error = current_exception();
+        }
+        {
+            lock_guard<mutex> lock(mtx);
+            if (error && !failure) failure = error;
+            if (--running == 0) done_cv.notify_one();
+        }
+    }
+}
+
+void ThreadPool::run(const function<void(size_t)>& task) {
+    if (workers.empty() || active_pool == this) {
+        task(0);
+        return;
+    }
+    lock_guard<mutex> serial(run_mtx);
+    {
+        lock_guard<mutex> lock(mtx);
+        job = &task;
+        running = workers.size();
+        failure = nullptr;
+        ++round;
+    }
+    work_cv.notify_all();
+    // The workers hold a pointer to `task`, so they are always waited for
+    // before an exception from any of them leaves run().
+    exception_ptr error;
+    {
+        ActiveScope scope(this);
+        try {
+            task(0);
+        } catch (...) {
+            error = current_exception();
+        }
+    }
+    unique_lock<mutex> lock(mtx);
+    done_cv.wait(lock, [&] { return running == 0; });
+    if (!error) error = failure;
+    failure = nullptr;
+    lock.unlock();
+    if (error) rethrow_exception(error);
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, const function<void(size_t, size_t, size_t)>& body) {
+    if (count == 0) return;
+    grain = max<size_t>(grain, 1);
+    if (workers.empty() || count <= grain) {
+        body(0, count, 0);
+        return;
+    }
+    atomic<size_t> next{0};
+    run([&](size_t worker) {
+        size_t begin;
+        while ((begin = next.fetch_add(grain)) < count) {
+            body(begin, min(begin + grain, count), worker);
+        }
+    });
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,221 @@
+#include "../include/traffic_feed.hpp"
+#include "../include/text_scanner.hpp"
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Non-blocking reads from the tailed file or pipe; read() returns 0 when
+// nothing new is available. A regular file that shrinks below the read
+// offset was truncated by log rotation and is read again from the start,
+// which read() reports through `rewound`.
+class TrafficFeed::Source {
+private:
+#if !defined(_WIN32)
+    int fd = -1;
+#else
+    ifstream file;
+#endif
+
+public:
+    explicit Source(const string& path) {
+#if !defined(_WIN32)
+        fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK);
+#else
+        file.open(path, ios::binary);
+#endif
+    }
+
+    ~Source() {
+#if !defined(_WIN32)
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    bool is_open() const {
+#if !defined(_WIN32)
+        return fd >= 0;
+#else
+        return file.is_open();
+#endif
+    }
+
+    size_t read(char* buffer, size_t capacity, bool& rewound) {
+        rewound = false;
+#if !defined(_WIN32)
+        ssize_t got = ::read(fd, buffer, capacity);
+        if (got > 0) return static_cast<size_t>(got);
+        struct stat st;
+        if (got == 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && lseek(fd, 0, SEEK_CUR) > st.st_size) {
+            lseek(fd, 0, SEEK_SET);
+            rewound = true;
+        }
+        return 0;
+#else
+        file.read(buffer, static_cast<streamsize>(capacity));
+        size_t got = static_cast<size_t>(file.gcount());
+        if (!file) file.clear();
+        return got;
+#endif
+    }
+};
+
+TrafficFeed::TrafficFeed(string path, FeedOptions opts) : path(move(path)), opts(opts) {}
+
+TrafficFeed::~TrafficFeed() {
+    stop();
+}
+
+bool TrafficFeed::start() {
+    if (reader.joinable()) return true;
+    source = make_unique<Source>(path);
+    if (!source->is_open()) {
+        source.reset();
+        return false;
+    }
+    stopping.store(false, memory_order_relaxed);
+    started = chrono::steady_clock::now();
+    reader = thread(&TrafficFeed::run, this);
+    return true;
+}
+
+void TrafficFeed::stop() {
+    if (!reader.joinable()) return;
+    stopping.store(true, memory_order_release);
+    reader.join();
+    source.reset();
+}
+
+bool TrafficFeed::running() const {
+    return reader.joinable() && !stopping.load(memory_order_acquire);
+}
+
+bool TrafficFeed::has_pending() const {
+    return sealed_count.load(memory_order_acquire) > 0;
+}
+
+// Reads one chunk and ingests the complete lines in it; a trailing partial
+// line waits in `partial` for the rest, and is dropped if the file was
+// truncated under it, since that line will never be completed.
+bool TrafficFeed::pump(string& partial, vector<char>& chunk) {
+    bool rewound;
+    size_t got = source->read(chunk.data(), chunk.size(), rewound);
+    if (rewound) partial.clear();
+    if (got == 0) return false;
+    partial.append(chunk.data(), got);
+    size_t last = partial.rfind('\n');
+    if (last == string::npos) return true;
+    LineReader in(string_view(partial.data(), last + 1));
+    string_view line;
+    while (in.next(line)) ingest(line);
+    partial.erase(0, last + 1);
+    return true;
+}
+
+// On stop, whatever the writer has already appended is still read, up to
+// DRAIN_CHUNKS chunks so an endless pipe cannot hold the thread.
+void TrafficFeed::run() {
+    constexpr size_t CHUNK = 1 << 16;
+    constexpr size_t DRAIN_CHUNKS = 64;
+    string partial;
+    vector<char> chunk(CHUNK);
+    while (!stopping.load(memory_order_acquire)) {
+        bool progressed = pump(partial, chunk);
+        if (!open.updates.empty() && chrono::steady_clock::now() - open.opened >= opts.window) seal();
+        if (!progressed) this_thread::sleep_for(opts.poll);
+    }
+    for (size_t i = 0; i < DRAIN_CHUNKS && pump(partial, chunk); ++i) {}
+    if (!open.updates.empty()) seal();
+}
+
+void TrafficFeed::ingest(string_view line) {
+    if (line.find_first_not_of(" \t") == string_view::npos) return;
+    lines.fetch_add(1, memory_order_relaxed);
+    FieldReader in(line);
+    Update u{};
+    string_view timestamp;
+    if (!(in.read(u.from) && in.read(u.to) && in.read(u.weight) && in.read(timestamp))) {
+        malformed.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    u.timed = parse_iso8601(timestamp, u.at);
+    updates.fetch_add(1, memory_order_relaxed);
+
+    if (open.updates.empty()) open.opened = chrono::steady_clock::now();
+    auto [it, fresh] = open_slot.emplace(TravelTimeTable::edge_key(u.from, u.to), open.updates.size());
+    if (fresh) {
+        open.updates.push_back(u);
+    } else {
+        open.updates[it->second] = u;
+        coalesced.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void TrafficFeed::seal() {
+    {
+        lock_guard<mutex> lock(mtx);
+        sealed.push_back(move(open));
+        sealed_count.fetch_add(1, memory_order_release);
+    }
+    open = Batch();
+    open_slot.clear();
+}
+
+// Later batches override earlier ones, so everything sealed so far is
+// merged and applied as a single step. Returns how many edge weights
+// changed.
+size_t TrafficFeed::apply_pending(RoadNetwork& graph) {
+    if (sealed_count.load(memory_order_acquire) == 0) return 0;
+    deque<Batch> ready;
+    {
+        lock_guard<mutex> lock(mtx);
+        ready.swap(sealed);
+        sealed_count.store(0, memory_order_release);
+    }
+
+    vector<EdgeUpdate> merged;
+    unordered_map<uint64_t, size_t> slot_of;
+    for (const auto& batch : ready) {
+        for (const auto& u : batch.updates) {
+            if (u.timed) graph.add_traffic_sample(u.from, u.to, u.at, u.weight);
+            auto [it, fresh] = slot_of.emplace(TravelTimeTable::edge_key(u.from, u.to), merged.size());
+            if (fresh) {
+                merged.push_back({u.from, u.to, u.weight});
+            } else {
+                merged[it->second].weight = u.weight;
+                coalesced.fetch_add(1, memory_order_relaxed);
+            }
+        }
+    }
+    size_t changed = graph.update_edge_weights(merged);
+
+    auto now = chrono::steady_clock::now();
+    lock_guard<mutex> lock(mtx);
+    for (const auto& batch : ready) {
+        double lag = chrono::duration<double, milli>(now - batch.opened).count();
+        lag_total_ms += lag;
+        lag_max_ms = max(lag_max_ms, lag);
+    }
+    batches_applied += ready.size();
+    edges_applied += changed;
+    return changed;
+}
+
+TrafficFeed::Stats TrafficFeed::stats() const {
+    Stats s;
+    s.lines = lines.load(memory_order_relaxed);
+    s.malformed = malformed.load(memory_order_relaxed);
+    s.updates = updates.load(memory_order_relaxed);
+    s.coalesced = coalesced.load(memory_order_relaxed);
+    lock_guard<mutex> lock(mtx);
+    s.batches = batches_applied;
+    s.applied = edges_applied;
+    s.mean_lag_ms = batches_applied ? lag_total_ms / batches_applied : 0.0;
+    s.max_lag_ms = lag_max_ms;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    s.updates_per_second = elapsed > 0.0 ? s.updates / elapsed : 0.0;
+    return s;
+}
@@ -0,0 +1,78 @@
+#include "../include/travel_time.hpp"
+#include <algorithm>
+
+uint64_t TravelTimeTable::edge_key(int from, int to) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(from)) << 32) | static_cast<uint32_t>(to);
+}
+
+double TravelTimeTable::seconds(TimePoint t) {
+    return chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+void TravelTimeTable::build(const CsrGraph& g, const Samples& samples, double unit_seconds) {
+    seconds_per_unit = unit_seconds;
+    size_t slots = g.num_edges();
+    offsets.assign(slots + 1, 0);
+    times.clear();
+    values.clear();
+
+    vector<pair<double, double>> points;
+    for (size_t u = 0; u < g.num_nodes(); ++u) {
+        for (size_t k = g.offsets[u]; k < g.offsets[u + 1]; ++k) {
+            offsets[k] = times.size();
+            auto it = samples.find(edge_key(g.id_of(static_cast<int>(u)), g.id_of(g.targets[k])));
+            if (it == samples.end()) continue;
+
+            points = it->second;
+            stable_sort(points.begin(), points.end(),
+                        [](const auto& a, const auto& b) { return a.first < b.first; });
+            for (size_t i = 0; i < points.size(); ++i) {
+                double t = points[i].first;
+                double v = points[i].second;
+                // A later sample at the same instant replaces the earlier one.
+                if (times.size() > offsets[k] && times.back() == t) {
+                    values.back() = v;
+                    continue;
+                }
+                times.push_back(t);
+                values.push_back(v);
+            }
+            for (size_t i = offsets[k] + 1; i < times.size(); ++i) {
+                double floor = values[i - 1] - (times[i] - times[i - 1]) / seconds_per_unit;
+                values[i] = max(values[i], floor);
+            }
+        }
+    }
+    offsets[slots] = times.size();
+}
+
+void TravelTimeTable::clear() {
+    offsets.clear();
+    times.clear();
+    values.clear();
+}
+
+bool TravelTimeTable::empty() const {
+    return times.empty();
+}
+
+size_t TravelTimeTable::breakpoints() const {
+    return times.size();
+}
+
+double TravelTimeTable::unit_seconds() const {
+    return seconds_per_unit;
+}
+
+double TravelTimeTable::evaluate(size_t slot, double t, double fallback) const {
+    if (slot + 1 >= offsets.size()) return fallback;
+    size_t lo = offsets[slot], hi = offsets[slot + 1];
+    if (lo == hi) return fallback;
+    if (t <= times[lo]) return values[lo];
+    if (t >= times[hi - 1]) return values[hi - 1];
+
+    size_t k = upper_bound(times.begin() + lo, times.begin() + hi, t) - times.begin();
+    double span = times[k] - times[k - 1];
+    double f = (t - times[k - 1]) / span;
+    return values[k - 1] + f * (values[k] - values[k - 1]);
+}
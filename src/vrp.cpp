@@ -0,0 +1,201 @@
+#include "../include/vrp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+struct Job {
+    size_t del;
+    double angle;
+};
+
+double free_capacity(const Vehicle& v) {
+    return max(0.0, v.capacity - v.current_load);
+}
+
+// Drop-offs at the same point are served together, on the first arrival.
+// Legs are timed by arrivals_at(), so the traffic expected along the way
+// applies rather than the static weights the plan was built on.
+bool on_time(const RoadNetwork& graph, const RoutePlan& plan, const vector<const Delivery*>& served,
+             TimePoint start) {
+    vector<int> stops = plan.stops();
+    vector<TimePoint> at = graph.arrivals_at(stops, start);
+    unordered_map<int, TimePoint> first;
+    for (size_t i = 0; i < at.size(); ++i) first.emplace(stops[i], at[i]);
+
+    for (const Delivery* d : served) {
+        auto it = first.find(d->dest_id);
+        if (it == first.end() || it->second > d->deadline) return false;
+    }
+    return true;
+}
+
+}
+
+VrpSolution solve_vrp(const RoadNetwork& graph, const HashTable<int, Location>& locations,
+                      const vector<Vehicle>& vehicles, const vector<Delivery>& deliveries,
+                      const VrpOptions& opts, ThreadPool& pool) {
+    size_t nv = vehicles.size();
+    VrpSolution sol;
+    sol.deliveries.assign(nv, {});
+    sol.loads.assign(nv, 0.0);
+    for (const auto& v : vehicles) sol.plans.emplace_back(v.current_pos.id);
+
+    vector<size_t> fleet;
+    double cx = 0.0, cy = 0.0, total_free = 0.0;
+    for (size_t v = 0; v < nv; ++v) {
+        cx += vehicles[v].current_x;
+        cy += vehicles[v].current_y;
+        if (free_capacity(vehicles[v]) > 0.0) {
+            fleet.push_back(v);
+            total_free += free_capacity(vehicles[v]);
+        }
+    }
+    if (fleet.empty()) {
+        for (const auto& d : deliveries) sol.unassigned.push_back(d.id);
+        return sol;
+    }
+    cx /= nv;
+    cy /= nv;
+
+    vector<Job> jobs;
+    double total_weight = 0.0;
+    for (size_t i = 0; i < deliveries.size(); ++i) {
+        auto loc = locations.find(deliveries[i].dest_id);
+        if (!loc) {
+            sol.unassigned.push_back(deliveries[i].id);
+            continue;
+        }
+        jobs.push_back({i, atan2((*loc)->y - cy, (*loc)->x - cx)});
+        total_weight += deliveries[i].weight;
+    }
+    sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.angle < b.angle; });
+
+    // Start the sweep after the widest empty sector so that no cluster
+    // straddles the densest part of the map.
+    if (jobs.size() > 1) {
+        size_t widest = 0;
+        double gap = jobs[0].angle + 2 * PI - jobs.back().angle;
+        for (size_t k = 1; k < jobs.size(); ++k) {
+            if (jobs[k].angle - jobs[k - 1].angle > gap) {
+                gap = jobs[k].angle - jobs[k - 1].angle;
+                widest = k;
+            }
+        }
+        rotate(jobs.begin(), jobs.begin() + widest, jobs.end());
+    }
+
+    auto angle_of = [&](size_t v) { return atan2(vehicles[v].current_y - cy, vehicles[v].current_x - cx); };
+    sort(fleet.begin(), fleet.end(), [&](size_t a, size_t b) { return angle_of(a) < angle_of(b); });
+    if (!jobs.empty()) {
+        auto first = find_if(fleet.begin(), fleet.end(), [&](size_t v) { return angle_of(v) >= jobs[0].angle; });
+        rotate(fleet.begin(), first == fleet.end() ? fleet.begin() : first, fleet.end());
+    }
+
+    vector<double> share(nv, 0.0);
+    for (size_t v : fleet) {
+        share[v] = min(free_capacity(vehicles[v]),
+                       total_weight * free_capacity(vehicles[v]) / total_free * (1.0 + opts.balance_slack));
+    }
+
+    vector<vector<size_t>> cluster(nv);
+    vector<size_t> overflow;
+    size_t cur = 0;
+    for (const Job& job : jobs) {
+        double w = deliveries[job.del].weight;
+        bool placed = false;
+        while (cur < fleet.size()) {
+            size_t v = fleet[cur];
+            if (sol.loads[v] + w <= share[v] || (sol.loads[v] == 0.0 && w <= free_capacity(vehicles[v]))) {
+                cluster[v].push_back(job.del);
+                sol.loads[v] += w;
+                placed = true;
+                break;
+            }
+            if (sol.loads[v] == 0.0) break;
+            ++cur;
+        }
+        if (!placed) overflow.push_back(job.del);
+    }
+
+    sort(overflow.begin(), overflow.end(), [&](size_t a, size_t b) {
+        return deliveries[a].weight > deliveries[b].weight;
+    });
+    for (size_t d : overflow) {
+        double w = deliveries[d].weight;
+        long best = -1;
+        double best_left = 0.0;
+        for (size_t v : fleet) {
+            double left = free_capacity(vehicles[v]) - sol.loads[v] - w;
+            if (left >= 0.0 && (best < 0 || left < best_left)) {
+                best = static_cast<long>(v);
+                best_left = left;
+            }
+        }
+        if (best < 0) {
+            sol.unassigned.push_back(deliveries[d].id);
+            continue;
+        }
+        cluster[best].push_back(d);
+        sol.loads[best] += w;
+    }
+
+    // Freeze the CSR view and the travel-time table once; the per-vehicle
+    // searches only read them.
+    graph.csr();
+    graph.travel_times();
+    vector<vector<int>> rejected(nv);
+    pool.parallel_for(nv, 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t v = begin; v < end; ++v) {
+            if (cluster[v].empty()) continue;
+            auto& members = cluster[v];
+            sort(members.begin(), members.end(), [&](size_t a, size_t b) {
+                return deliveries[a].deadline < deliveries[b].deadline;
+            });
+
+            RoutePlan& plan = sol.plans[v];
+            vector<const Delivery*> served;
+            for (size_t d : members) {
+                const Delivery& del = deliveries[d];
+                if (!plan.insert(graph, del.dest_id)) {
+                    rejected[v].push_back(del.id);
+                    continue;
+                }
+                served.push_back(&del);
+                if (opts.check_deadlines && !on_time(graph, plan, served, opts.start_time)) {
+                    plan.erase(del.dest_id);
+                    served.pop_back();
+                    rejected[v].push_back(del.id);
+                }
+            }
+
+            RoutePlan before = plan;
+            plan.improve(chrono::steady_clock::now() + opts.improve_budget);
+            if (opts.check_deadlines && !on_time(graph, plan, served, opts.start_time)) plan = move(before);
+
+            unordered_map<int, vector<const Delivery*>> at_stop;
+            for (const Delivery* d : served) at_stop[d->dest_id].push_back(d);
+            for (auto& [stop, list] : at_stop) reverse(list.begin(), list.end());
+            vector<int> stops = plan.stops();
+            for (size_t i = 1; i < stops.size(); ++i) {
+                auto& list = at_stop[stops[i]];
+                if (list.empty()) continue;
+                sol.deliveries[v].push_back(list.back()->id);
+                list.pop_back();
+            }
+        }
+    });
+
+    unordered_map<int, double> weight_of;
+    for (const auto& d : deliveries) weight_of[d.id] = d.weight;
+    for (size_t v = 0; v < nv; ++v) {
+        for (int id : rejected[v]) {
+            sol.loads[v] -= weight_of[id];
+            sol.unassigned.push_back(id);
+        }
+    }
+    return sol;
+}